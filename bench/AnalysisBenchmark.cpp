@@ -0,0 +1,102 @@
+#include "BenchmarkUtils.h"
+#include "AudioAnalyzer.h"
+#include "ChordDetector.h"
+#include "AnalysisFrame.h"
+
+// The analysis path: AudioAnalyzer::processAudio per callback block (window
+// accumulation plus a full analysis every hop), and ChordDetector on its own
+// per analysis frame, both the allocation-free id path the analyzer uses and
+// the ChordInfo path.
+namespace
+{
+    constexpr int analysisWindowSize = 2048;
+    constexpr int analysisHopSize = 512;
+
+    void BM_AudioAnalyzer(benchmark::State& state)
+    {
+        const int blockSize = static_cast<int>(state.range(0));
+        const double sampleRate = static_cast<double>(state.range(1));
+
+        AudioAnalyzer analyzer;
+        analyzer.setAnalysisWindowSize(analysisWindowSize);
+        analyzer.setAnalysisHopSize(analysisHopSize);
+        analyzer.prepareToPlay(blockSize, sampleRate);
+
+        juce::AudioBuffer<float> buffer(bench::numChannels, blockSize);
+        bench::GuitarSignal signal(sampleRate);
+
+        const double elapsedSeconds = bench::runBlocks(state, buffer, signal, [&](juce::AudioBuffer<float>& block, int)
+        {
+            analyzer.processAudio(block);
+        });
+
+        analyzer.releaseResources();
+        bench::setRealtimeCounters(state, elapsedSeconds, blockSize, bench::numChannels, sampleRate);
+    }
+
+    // The spectral peaks AudioAnalyzer would hand over for an open E major
+    // chord: fundamentals and partials, strongest first
+    void fillChordFrame(AnalysisFrame& frame, double sampleRate)
+    {
+        frame.prepare(analysisWindowSize, analysisWindowSize * 2, 32, sampleRate);
+
+        const float peaks[][2] = {
+            { 82.41f, 1.0f },   { 164.81f, 0.9f },  { 123.47f, 0.8f },  { 207.65f, 0.7f },
+            { 246.94f, 0.65f }, { 329.63f, 0.6f },  { 247.23f, 0.5f },  { 370.41f, 0.4f },
+            { 415.30f, 0.35f }, { 494.88f, 0.3f },  { 494.44f, 0.25f }, { 659.26f, 0.2f },
+            { 622.93f, 0.15f }, { 740.82f, 0.12f }, { 988.88f, 0.1f },  { 1318.5f, 0.08f },
+        };
+
+        for (const auto& peak : peaks)
+        {
+            frame.peakFrequencies.push_back(peak[0]);
+            frame.peakMagnitudes.push_back(peak[1]);
+        }
+    }
+
+    template <typename Detect>
+    void runChordDetector(benchmark::State& state, Detect&& detect)
+    {
+        const double sampleRate = static_cast<double>(state.range(0));
+
+        ChordDetector detector;
+        detector.prepareToPlay(sampleRate);
+
+        AnalysisFrame frame;
+        fillChordFrame(frame, sampleRate);
+
+        const bench::LoopTimer timer;
+        for (auto _ : state)
+            detect(detector, frame);
+
+        // One detection per hop, so real time here is the hop period
+        bench::setRealtimeCounters(state, timer.getElapsedSeconds(), analysisHopSize, 1, sampleRate);
+        detector.releaseResources();
+    }
+
+    void BM_ChordDetectorId(benchmark::State& state)
+    {
+        runChordDetector(state, [](ChordDetector& detector, const AnalysisFrame& frame)
+        {
+            benchmark::DoNotOptimize(detector.detectChordId(frame));
+        });
+    }
+
+    void BM_ChordDetectorInfo(benchmark::State& state)
+    {
+        runChordDetector(state, [](ChordDetector& detector, const AnalysisFrame& frame)
+        {
+            auto chord = detector.detectChord(frame);
+            benchmark::DoNotOptimize(chord);
+        });
+    }
+
+    void sampleRates(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgName("rate")->Arg(44100)->Arg(48000)->Arg(96000)->Arg(192000)->UseRealTime();
+    }
+}
+
+BENCHMARK(BM_AudioAnalyzer)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK(BM_ChordDetectorId)->Apply(sampleRates);
+BENCHMARK(BM_ChordDetectorInfo)->Apply(sampleRates);
@@ -0,0 +1,19 @@
+#include <juce_events/juce_events.h>
+#include <benchmark/benchmark.h>
+
+// ToneTriggerBench entry point. JUCE is initialised first because some of the
+// code under test (AudioVisualizer's timer) expects a message manager. Use the
+// usual Google Benchmark flags, e.g. --benchmark_filter=Effect or
+// --benchmark_format=json --benchmark_out=results.json to keep a baseline.
+int main(int argc, char** argv)
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cmath>
+
+// Shared setup for the ToneTriggerBench suites. Block benchmarks time only the
+// call under test (manual time), so refilling the input between iterations
+// doesn't count. Every benchmark reports, from the time it measured:
+//   ns/sample   - wall time per sample, per channel
+//   x_realtime  - how many times faster than real time the stage runs
+//   %period     - share of the block period the stage uses
+namespace bench
+{
+    constexpr int numChannels = 2;
+
+    // Block sizes and sample rates every block benchmark sweeps
+    inline void blockSizesAndSampleRates(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgNames({ "block", "rate" })
+                 ->ArgsProduct({ benchmark::CreateRange(32, 4096, 2), { 44100, 48000, 96000, 192000 } })
+                 ->UseManualTime();
+    }
+
+    // Plain counters rather than rate counters, so they print without units
+    inline void setRealtimeCounters(benchmark::State& state, double elapsedSeconds, int samplesPerCall, int channels,
+                                    double sampleRate)
+    {
+        const double samplesProcessed = static_cast<double>(state.iterations()) * samplesPerCall;
+        const double audioSeconds = samplesProcessed / sampleRate;
+
+        if (samplesProcessed <= 0.0 || elapsedSeconds <= 0.0)
+            return;
+
+        state.counters["ns/sample"] = elapsedSeconds * 1.0e9 / (samplesProcessed * channels);
+        state.counters["x_realtime"] = audioSeconds / elapsedSeconds;
+        state.counters["%period"] = 100.0 * elapsedSeconds / audioSeconds;
+    }
+
+    // Times a whole benchmark loop, for calls too short to time one by one
+    class LoopTimer
+    {
+    public:
+        LoopTimer() : start(std::chrono::steady_clock::now()) {}
+
+        double getElapsedSeconds() const
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // An open E major chord with a few decaying partials and some pick noise,
+    // continuous across blocks, so the detectors have something to find
+    class GuitarSignal
+    {
+    public:
+        explicit GuitarSignal(double sampleRate)
+        {
+            const double fundamentals[numStrings] = { 82.41, 123.47, 164.81, 207.65, 246.94, 329.63 };
+            for (int string = 0; string < numStrings; ++string)
+                phaseIncrements[string] = juce::MathConstants<double>::twoPi * fundamentals[string] / sampleRate;
+        }
+
+        void fill(juce::AudioBuffer<float>& buffer)
+        {
+            const int numSamples = buffer.getNumSamples();
+
+            for (int sample = 0; sample < numSamples; ++sample)
+            {
+                double value = 0.0;
+                for (int string = 0; string < numStrings; ++string)
+                {
+                    for (int partial = 1; partial <= numPartials; ++partial)
+                        value += std::sin(phases[string] * partial) / (partial * numStrings);
+
+                    phases[string] += phaseIncrements[string];
+                    if (phases[string] >= juce::MathConstants<double>::twoPi)
+                        phases[string] -= juce::MathConstants<double>::twoPi;
+                }
+
+                const float output = static_cast<float>(value * 0.5) + (random.nextFloat() - 0.5f) * 0.01f;
+                for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                    buffer.setSample(channel, sample, output);
+            }
+        }
+
+    private:
+        static constexpr int numStrings = 6;
+        static constexpr int numPartials = 4;
+        double phases[numStrings] = {};
+        double phaseIncrements[numStrings] = {};
+        juce::Random random { 1 };
+    };
+
+    // Refills the buffer, then times process(buffer, iteration) alone.
+    // Returns the total time spent in process().
+    template <typename Process>
+    double runBlocks(benchmark::State& state, juce::AudioBuffer<float>& buffer, GuitarSignal& signal, Process&& process)
+    {
+        int iteration = 0;
+        double elapsedSeconds = 0.0;
+
+        for (auto _ : state)
+        {
+            signal.fill(buffer);
+
+            const auto start = std::chrono::steady_clock::now();
+            process(buffer, iteration++);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            state.SetIterationTime(seconds);
+            elapsedSeconds += seconds;
+        }
+
+        return elapsedSeconds;
+    }
+}
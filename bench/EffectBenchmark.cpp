@@ -0,0 +1,153 @@
+#include "BenchmarkUtils.h"
+#include "Effects/DistortionEffect.h"
+#include "Effects/FilterEffect.h"
+#include "Effects/CompressorEffect.h"
+#include "Effects/DelayEffect.h"
+#include "Effects/ReverbEffect.h"
+#include "Effects/ChorusEffect.h"
+#include "EffectProcessor.h"
+#include "Utils/RealtimeWorkerPool.h"
+#include <memory>
+
+// Effect block kernels, each with static parameters (the block-rate path) and
+// with a parameter swept every block (the ramp path), plus the AudioProcessor
+// gain stage as the per-sample loop it replaced against the vectorised one, and
+// a chain of channel-independent effects with and without worker threads.
+namespace
+{
+    using EffectFactory = std::unique_ptr<BaseEffect> (*)();
+
+    template <typename Effect>
+    std::unique_ptr<BaseEffect> createEffect()
+    {
+        return std::make_unique<Effect>();
+    }
+
+    void runEffect(benchmark::State& state, EffectFactory create, int sweptParameter)
+    {
+        const int blockSize = static_cast<int>(state.range(0));
+        const double sampleRate = static_cast<double>(state.range(1));
+
+        auto effect = create();
+        effect->prepareToPlay(blockSize, sampleRate, bench::numChannels);
+
+        // Alternate between the ends of the range so the parameter is always ramping
+        const float low = sweptParameter >= 0 ? effect->getParameterMinValue(sweptParameter) : 0.0f;
+        const float high = sweptParameter >= 0 ? effect->getParameterMaxValue(sweptParameter) : 0.0f;
+
+        juce::AudioBuffer<float> buffer(bench::numChannels, blockSize);
+        bench::GuitarSignal signal(sampleRate);
+
+        const double elapsedSeconds = bench::runBlocks(state, buffer, signal, [&](juce::AudioBuffer<float>& block, int iteration)
+        {
+            if (sweptParameter >= 0)
+                effect->setParameter(sweptParameter, (iteration & 1) != 0 ? high : low);
+            effect->processAudio(block);
+        });
+
+        effect->releaseResources();
+        bench::setRealtimeCounters(state, elapsedSeconds, blockSize, bench::numChannels, sampleRate);
+    }
+
+    void BM_EffectStatic(benchmark::State& state, EffectFactory create)
+    {
+        runEffect(state, create, -1);
+    }
+
+    void BM_EffectSweep(benchmark::State& state, EffectFactory create, int sweptParameter)
+    {
+        runEffect(state, create, sweptParameter);
+    }
+
+    void BM_GainScalar(benchmark::State& state)
+    {
+        const int blockSize = static_cast<int>(state.range(0));
+        const double sampleRate = static_cast<double>(state.range(1));
+        const float gain = 0.7f;
+
+        juce::AudioBuffer<float> buffer(bench::numChannels, blockSize);
+        bench::GuitarSignal signal(sampleRate);
+
+        const double elapsedSeconds = bench::runBlocks(state, buffer, signal, [&](juce::AudioBuffer<float>& block, int)
+        {
+            for (int channel = 0; channel < block.getNumChannels(); ++channel)
+            {
+                float* channelData = block.getWritePointer(channel);
+                for (int sample = 0; sample < block.getNumSamples(); ++sample)
+                    channelData[sample] *= gain;
+            }
+            benchmark::ClobberMemory();
+        });
+
+        bench::setRealtimeCounters(state, elapsedSeconds, blockSize, bench::numChannels, sampleRate);
+    }
+
+    void BM_GainVector(benchmark::State& state)
+    {
+        const int blockSize = static_cast<int>(state.range(0));
+        const double sampleRate = static_cast<double>(state.range(1));
+        const float gain = 0.7f;
+
+        juce::AudioBuffer<float> buffer(bench::numChannels, blockSize);
+        bench::GuitarSignal signal(sampleRate);
+
+        const double elapsedSeconds = bench::runBlocks(state, buffer, signal, [&](juce::AudioBuffer<float>& block, int)
+        {
+            for (int channel = 0; channel < block.getNumChannels(); ++channel)
+                juce::FloatVectorOperations::multiply(block.getWritePointer(channel), gain, block.getNumSamples());
+            benchmark::ClobberMemory();
+        });
+
+        bench::setRealtimeCounters(state, elapsedSeconds, blockSize, bench::numChannels, sampleRate);
+    }
+
+    // Distortion, filter and delay on a stereo lane, serial (0 workers) or
+    // with the second channel on a worker
+    void BM_ChainWorkers(benchmark::State& state)
+    {
+        const int blockSize = static_cast<int>(state.range(0));
+        const int numWorkers = static_cast<int>(state.range(1));
+        const double sampleRate = 48000.0;
+
+        RealtimeWorkerPool workerPool;
+        workerPool.prepare(numWorkers, blockSize, sampleRate);
+
+        EffectProcessor effectProcessor;
+        effectProcessor.prepareToPlay(blockSize, sampleRate, bench::numChannels);
+        effectProcessor.setWorkerPool(&workerPool);
+        effectProcessor.addEffect(EffectType::Distortion);
+        effectProcessor.addEffect(EffectType::Filter);
+        effectProcessor.addEffect(EffectType::Delay);
+        delete effectProcessor.exchangeRenderList(effectProcessor.createRenderList({}));
+
+        juce::AudioBuffer<float> buffer(bench::numChannels, blockSize);
+        bench::GuitarSignal signal(sampleRate);
+
+        const double elapsedSeconds = bench::runBlocks(state, buffer, signal, [&](juce::AudioBuffer<float>& block, int)
+        {
+            effectProcessor.processAudio(block);
+        });
+
+        effectProcessor.releaseResources();
+        workerPool.release();
+        bench::setRealtimeCounters(state, elapsedSeconds, blockSize, bench::numChannels, sampleRate);
+    }
+}
+
+BENCHMARK(BM_ChainWorkers)->ArgNames({ "block", "workers" })
+                          ->ArgsProduct({ benchmark::CreateRange(64, 4096, 2), { 0, 1 } })
+                          ->UseManualTime();
+BENCHMARK_CAPTURE(BM_EffectStatic, Distortion, &createEffect<DistortionEffect>)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectSweep, Distortion, &createEffect<DistortionEffect>, DistortionEffect::Drive)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectStatic, Filter, &createEffect<FilterEffect>)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectSweep, Filter, &createEffect<FilterEffect>, FilterEffect::Cutoff)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectStatic, Compressor, &createEffect<CompressorEffect>)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectSweep, Compressor, &createEffect<CompressorEffect>, CompressorEffect::Threshold)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectStatic, Delay, &createEffect<DelayEffect>)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectSweep, Delay, &createEffect<DelayEffect>, DelayEffect::Time)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectStatic, Reverb, &createEffect<ReverbEffect>)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectSweep, Reverb, &createEffect<ReverbEffect>, ReverbEffect::RoomSize)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectStatic, Chorus, &createEffect<ChorusEffect>)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_EffectSweep, Chorus, &createEffect<ChorusEffect>, ChorusEffect::Rate)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK(BM_GainScalar)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK(BM_GainVector)->Apply(bench::blockSizesAndSampleRates);
@@ -0,0 +1,68 @@
+#include "BenchmarkUtils.h"
+#include "TriggerManager.h"
+#include "TriggerProgram.h"
+
+// TriggerManager::checkTriggers once per callback block with 10, 100 and 1000
+// triggers loaded. The detected note and chord walk a progression, so triggers
+// keep firing, holding and releasing the way they do while playing.
+namespace
+{
+    void BM_CheckTriggers(benchmark::State& state)
+    {
+        const int numTriggers = static_cast<int>(state.range(0));
+        const int blockSize = static_cast<int>(state.range(1));
+        const double sampleRate = static_cast<double>(state.range(2));
+
+        TriggerManager triggerManager;
+        triggerManager.prepareToPlay(blockSize, sampleRate);
+
+        // Half note triggers, a quarter each chord and melody triggers, spread
+        // over the guitar's range and 16 effects
+        for (int i = 0; i < numTriggers; ++i)
+        {
+            const int note = 40 + i % 48;
+            const int effectId = i % 16;
+
+            switch (i % 4)
+            {
+                case 0:
+                case 1:
+                    triggerManager.addNoteTrigger(note, effectId);
+                    break;
+                case 2:
+                    triggerManager.addChordTrigger({ note, note + 4, note + 7 }, effectId);
+                    break;
+                case 3:
+                    triggerManager.addMelodyTrigger({ note, note + 2, note + 4, note + 5 }, effectId);
+                    break;
+            }
+        }
+
+        triggerManager.setTriggerCallback([](int, bool) {});
+        triggerManager.publishPendingChanges();
+
+        const float notes[] = { 40.0f, 45.0f, 47.0f, -1.0f, 52.0f, 57.0f, 59.0f, 64.0f };
+        // E, A and B major as pitch-class masks
+        const int e = TriggerProgram::getPitchClassMask({ 4, 8, 11 });
+        const int a = TriggerProgram::getPitchClassMask({ 9, 1, 4 });
+        const int b = TriggerProgram::getPitchClassMask({ 11, 3, 6 });
+        const int chords[] = { e, a, b, 0, e, a, b, e };
+        int step = 0;
+
+        const bench::LoopTimer timer;
+        for (auto _ : state)
+        {
+            // Hold each note for a few blocks, as a player would
+            const int index = (step++ / 4) & 7;
+            triggerManager.checkTriggers(notes[index], chords[index], blockSize);
+        }
+
+        bench::setRealtimeCounters(state, timer.getElapsedSeconds(), blockSize, 1, sampleRate);
+        triggerManager.releaseResources();
+    }
+}
+
+BENCHMARK(BM_CheckTriggers)
+    ->ArgNames({ "triggers", "block", "rate" })
+    ->ArgsProduct({ { 10, 100, 1000 }, benchmark::CreateRange(32, 4096, 2), { 44100, 48000, 96000, 192000 } })
+    ->UseRealTime();
@@ -0,0 +1,31 @@
+#include "BenchmarkUtils.h"
+#include "UI/AudioVisualizer.h"
+
+// AudioVisualizer::pushAudioData per callback block, in the waveform mode and
+// in the spectrum modes that also recompute the display data on every push.
+namespace
+{
+    void BM_VisualizerPush(benchmark::State& state, AudioVisualizer::VisualizerType type)
+    {
+        const int blockSize = static_cast<int>(state.range(0));
+        const double sampleRate = static_cast<double>(state.range(1));
+
+        AudioVisualizer visualizer;
+        visualizer.setSampleRate(sampleRate);
+        visualizer.setVisualizerType(type);
+
+        juce::AudioBuffer<float> buffer(bench::numChannels, blockSize);
+        bench::GuitarSignal signal(sampleRate);
+
+        const double elapsedSeconds = bench::runBlocks(state, buffer, signal, [&](juce::AudioBuffer<float>& block, int)
+        {
+            visualizer.pushAudioData(block);
+        });
+
+        bench::setRealtimeCounters(state, elapsedSeconds, blockSize, bench::numChannels, sampleRate);
+    }
+}
+
+BENCHMARK_CAPTURE(BM_VisualizerPush, Waveform, AudioVisualizer::VisualizerType::Waveform)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_VisualizerPush, Spectrum, AudioVisualizer::VisualizerType::Spectrum)->Apply(bench::blockSizesAndSampleRates);
+BENCHMARK_CAPTURE(BM_VisualizerPush, Waterfall, AudioVisualizer::VisualizerType::Waterfall)->Apply(bench::blockSizesAndSampleRates);
@@ -0,0 +1,370 @@
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "AudioProcessor.h"
+#include "TriggerManager.h"
+#include "EffectProcessor.h"
+#include <cstdio>
+#include <vector>
+
+// Streams an audio file through AudioProcessor with no audio device, the way
+// the live callback would: fixed-size blocks, synchronous analysis, triggers
+// and effects set up from a preset before the first block. The output is
+// bit-for-bit repeatable for a given input, preset and block size, so renders
+// can be diffed in CI; the trigger log and real-time factor come along with it.
+//
+// Preset (JSON, same field names as CompletePreset):
+//   {
+//     "effects":  [ { "effectType": "Delay", "lane": 0, "enabled": true, "parameters": { "Time": 0.25, "2": 0.4 } } ],
+//     "triggers": [ { "triggerType": "Note", "notes": [ 64 ], "effectId": 0, "threshold": 0.5 } ],
+//     "audioSettings": { "inputGain": 1.0, "outputGain": 1.0 }
+//   }
+// A trigger's effectId is the index of its effect in "effects", and the trigger
+// goes on that effect's lane; parameters are keyed by index or name. Lanes only
+// matter with --layout=per-input, where lane n processes the file's channel n.
+namespace
+{
+    struct TriggerEvent
+    {
+        juce::int64 sample;  // Start of the block the trigger changed in
+        int lane;
+        int effectId;
+        bool activated;
+    };
+
+    void printUsage()
+    {
+        std::printf("Usage: ToneTriggerRender --input=<file> --output=<file> [options]\n"
+                    "  --input=<file>       WAV or FLAC to process\n"
+                    "  --output=<file>      WAV (32-bit float) or FLAC (24-bit) to write\n"
+                    "  --preset=<file>      JSON preset with effects and triggers\n"
+                    "  --events=<file>      Tab-separated trigger event log\n"
+                    "  --block-size=<n>     Samples per block, 16-8192 (default 256)\n"
+                    "  --layout=<layout>    linked (default): one lane across every channel\n"
+                    "                       per-input: a lane per channel, set up by the preset's \"lane\" fields\n");
+    }
+
+    const char* const effectTypeNames[] = { "Distortion", "Reverb", "Delay", "Chorus", "Filter", "Compressor" };
+
+    int findEffectType(const juce::String& name)
+    {
+        for (int type = 0; type <= static_cast<int>(EffectType::Compressor); ++type)
+        {
+            if (name.equalsIgnoreCase(effectTypeNames[type]))
+                return type;
+        }
+        return -1;
+    }
+
+    int findParameter(const BaseEffect& effect, const juce::String& key)
+    {
+        if (key.containsOnly("0123456789"))
+            return key.getIntValue() < effect.getNumParameters() ? key.getIntValue() : -1;
+
+        for (int parameter = 0; parameter < effect.getNumParameters(); ++parameter)
+        {
+            if (effect.getParameterName(parameter).equalsIgnoreCase(key))
+                return parameter;
+        }
+        return -1;
+    }
+
+    std::vector<int> toNotes(const juce::var& notes)
+    {
+        std::vector<int> result;
+        if (auto* array = notes.getArray())
+        {
+            for (const auto& note : *array)
+                result.push_back(static_cast<int>(note));
+        }
+        return result;
+    }
+
+    // Sets up effects and triggers before the processor is prepared, so every
+    // edit is applied directly rather than through the audio thread's queue
+    bool loadPreset(const juce::File& file, AudioProcessor& processor)
+    {
+        const auto preset = juce::JSON::parse(file);
+        if (!preset.isObject())
+        {
+            std::fprintf(stderr, "Can't parse preset %s\n", file.getFullPathName().toRawUTF8());
+            return false;
+        }
+
+        struct LoadedEffect
+        {
+            int lane;
+            int effectId;
+        };
+
+        std::vector<LoadedEffect> loadedEffects;
+
+        if (auto* effects = preset["effects"].getArray())
+        {
+            for (const auto& effectPreset : *effects)
+            {
+                const int lane = effectPreset.getProperty("lane", 0);
+                auto* effectProcessor = processor.getEffectProcessor(lane);
+                if (effectProcessor == nullptr)
+                {
+                    std::fprintf(stderr, "Lane %d isn't in 0-%d\n", lane, AudioProcessor::maxLanes - 1);
+                    return false;
+                }
+
+                const auto typeName = effectPreset["effectType"].toString();
+                const int effectId = processor.addEffect(findEffectType(typeName), lane);
+                if (effectId < 0)
+                {
+                    std::fprintf(stderr, "Unknown effect type \"%s\"\n", typeName.toRawUTF8());
+                    return false;
+                }
+
+                loadedEffects.push_back({ lane, effectId });
+
+                if (auto* parameters = effectPreset["parameters"].getDynamicObject())
+                {
+                    for (const auto& parameter : parameters->getProperties())
+                    {
+                        const auto key = parameter.name.toString();
+                        const int parameterId = findParameter(*effectProcessor->getEffect(effectId)->effect, key);
+                        if (parameterId < 0)
+                        {
+                            std::fprintf(stderr, "%s has no parameter \"%s\"\n", typeName.toRawUTF8(), key.toRawUTF8());
+                            return false;
+                        }
+
+                        processor.setEffectParameter(effectId, parameterId, static_cast<float>(parameter.value), lane);
+                    }
+                }
+
+                if (effectPreset.hasProperty("enabled"))
+                    processor.setEffectEnabled(effectId, static_cast<bool>(effectPreset["enabled"]), lane);
+            }
+        }
+
+        if (auto* triggers = preset["triggers"].getArray())
+        {
+            for (const auto& triggerPreset : *triggers)
+            {
+                const int effectIndex = triggerPreset.getProperty("effectId", -1);
+                if (effectIndex < 0 || effectIndex >= static_cast<int>(loadedEffects.size()))
+                {
+                    std::fprintf(stderr, "Trigger effectId %d isn't an index into \"effects\"\n", effectIndex);
+                    return false;
+                }
+
+                const int lane = loadedEffects[static_cast<size_t>(effectIndex)].lane;
+                const int effectId = loadedEffects[static_cast<size_t>(effectIndex)].effectId;
+                auto* triggerManager = processor.getTriggerManager(lane);
+                const auto type = triggerPreset["triggerType"].toString();
+                const auto notes = toNotes(triggerPreset["notes"]);
+                int triggerId = -1;
+
+                if (type.equalsIgnoreCase("Note") && !notes.empty())
+                    triggerId = processor.addNoteTrigger(notes.front(), effectId, lane);
+                else if (type.equalsIgnoreCase("Chord") && !notes.empty())
+                    triggerId = processor.addChordTrigger(notes, effectId, lane);
+                else if (type.equalsIgnoreCase("Melody") && !notes.empty())
+                    triggerId = processor.addMelodyTrigger(notes, effectId, lane);
+
+                if (triggerId < 0)
+                {
+                    std::fprintf(stderr, "Can't add %s trigger\n", type.toRawUTF8());
+                    return false;
+                }
+
+                if (triggerPreset.hasProperty("threshold"))
+                    triggerManager->setTriggerThreshold(triggerId, static_cast<float>(triggerPreset["threshold"]));
+                if (triggerPreset.hasProperty("enabled"))
+                    triggerManager->enableTrigger(triggerId, static_cast<bool>(triggerPreset["enabled"]));
+            }
+        }
+
+        const auto& audioSettings = preset["audioSettings"];
+        processor.setInputGain(static_cast<float>(audioSettings.getProperty("inputGain", 1.0)));
+        processor.setOutputGain(static_cast<float>(audioSettings.getProperty("outputGain", 1.0)));
+
+        // Compile the trigger programs here rather than racing the builder thread
+        for (int lane = 0; lane < AudioProcessor::maxLanes; ++lane)
+            processor.getTriggerManager(lane)->publishPendingChanges();
+        return true;
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> createWriter(juce::AudioFormatManager& formatManager, const juce::File& file,
+                                                          double sampleRate, int numChannels)
+    {
+        auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+        if (format == nullptr)
+            return nullptr;
+
+        file.deleteFile();
+        auto stream = file.createOutputStream();
+        if (stream == nullptr)
+            return nullptr;
+
+        // Float WAV keeps renders exact for diffing; FLAC tops out at 24 bits
+        const int bitsPerSample = format->getPossibleBitDepths().contains(32) ? 32 : 24;
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate,
+                                                                                static_cast<unsigned int>(numChannels),
+                                                                                bitsPerSample, {}, 0));
+        if (writer != nullptr)
+            stream.release(); // Owned by the writer now
+
+        return writer;
+    }
+
+    bool writeEventLog(const juce::File& file, const std::vector<TriggerEvent>& events, double sampleRate,
+                       const AudioProcessor& processor)
+    {
+        juce::String log = "sample\ttime\tlane\teffect\tname\tstate\n";
+
+        for (const auto& event : events)
+        {
+            auto* effect = processor.getEffectProcessor(event.lane)->getEffect(event.effectId);
+            log << juce::String(event.sample) << "\t"
+                << juce::String(static_cast<double>(event.sample) / sampleRate, 6) << "\t"
+                << event.lane << "\t"
+                << event.effectId << "\t"
+                << (effect != nullptr ? effect->effect->getName() : juce::String("-")) << "\t"
+                << (event.activated ? "on" : "off") << "\n";
+        }
+
+        return file.replaceWithText(log);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h") || !args.containsOption("--input") || !args.containsOption("--output"))
+    {
+        printUsage();
+        return args.containsOption("--help|-h") ? 0 : 1;
+    }
+
+    const auto inputFile = args.getFileForOption("--input");
+    const auto outputFile = args.getFileForOption("--output");
+    const int blockSize = juce::jlimit(16, 8192, args.containsOption("--block-size")
+                                                     ? args.getValueForOption("--block-size").getIntValue()
+                                                     : 256);
+
+    // Input
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(inputFile));
+    if (reader == nullptr)
+    {
+        std::fprintf(stderr, "Can't read %s\n", inputFile.getFullPathName().toRawUTF8());
+        return 1;
+    }
+
+    const double sampleRate = reader->sampleRate;
+    const juce::int64 lengthInSamples = reader->lengthInSamples;
+
+    // Every channel in the file is an input
+    const int numFileChannels = juce::jmax(1, static_cast<int>(reader->numChannels));
+
+    auto writer = createWriter(formatManager, outputFile, sampleRate, numFileChannels);
+    if (writer == nullptr)
+    {
+        std::fprintf(stderr, "Can't write %s\n", outputFile.getFullPathName().toRawUTF8());
+        return 1;
+    }
+
+    // Processor
+    AudioProcessor processor;
+    processor.setAnalysisMode(AnalysisMode::Synchronous); // Background analysis would depend on thread timing
+    processor.setParallelProcessing(false); // Keeps the event log in lane order, and the trigger callbacks on one thread
+    processor.setNumInputChannels(numFileChannels);
+
+    const auto layout = args.getValueForOption("--layout");
+    if (layout.isEmpty() || layout == "linked")
+        processor.setChannelLayout(ChannelLayout::Linked);
+    else if (layout == "per-input")
+        processor.setChannelLayout(ChannelLayout::PerInput);
+    else
+    {
+        std::fprintf(stderr, "Unknown layout \"%s\"\n", layout.toRawUTF8());
+        return 1;
+    }
+
+    if (processor.getChannelLayout() == ChannelLayout::PerInput && numFileChannels > AudioProcessor::maxLanes)
+        std::fprintf(stderr, "Only the first %d of %d channels get a lane\n", AudioProcessor::maxLanes, numFileChannels);
+
+    if (args.containsOption("--preset") && !loadPreset(args.getFileForOption("--preset"), processor))
+        return 1;
+
+    std::vector<TriggerEvent> events;
+    events.reserve(65536);
+    juce::int64 blockStart = 0;
+    int droppedEvents = 0;
+
+    for (int lane = 0; lane < AudioProcessor::maxLanes; ++lane)
+    {
+        processor.getTriggerManager(lane)->setTriggerCallback([&, lane](int effectId, bool activated)
+        {
+            // Called from inside the block, so stay within what was reserved
+            if (events.size() < events.capacity())
+                events.push_back({ blockStart, lane, effectId, activated });
+            else
+                ++droppedEvents;
+        });
+    }
+
+    processor.prepareToPlay(blockSize, sampleRate);
+
+    // Render
+    juce::AudioBuffer<float> buffer(numFileChannels, blockSize);
+    juce::int64 processingTicks = 0;
+    juce::int64 slowestBlockTicks = 0;
+
+    for (blockStart = 0; blockStart < lengthInSamples; blockStart += blockSize)
+    {
+        const int numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(blockSize), lengthInSamples - blockStart));
+
+        buffer.clear();
+        reader->read(&buffer, 0, numSamples, blockStart, true, true);
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        processor.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, numSamples));
+        const auto blockTicks = juce::Time::getHighResolutionTicks() - startTicks;
+
+        processingTicks += blockTicks;
+        slowestBlockTicks = juce::jmax(slowestBlockTicks, blockTicks);
+
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+        {
+            std::fprintf(stderr, "Write failed at sample %lld\n", static_cast<long long>(blockStart));
+            return 1;
+        }
+    }
+
+    processor.releaseResources();
+    writer.reset();
+
+    if (args.containsOption("--events"))
+    {
+        const auto eventsFile = args.getFileForOption("--events");
+        if (!writeEventLog(eventsFile, events, sampleRate, processor))
+        {
+            std::fprintf(stderr, "Can't write %s\n", eventsFile.getFullPathName().toRawUTF8());
+            return 1;
+        }
+    }
+
+    // Report
+    const double audioSeconds = static_cast<double>(lengthInSamples) / sampleRate;
+    const double processingSeconds = juce::Time::highResolutionTicksToSeconds(processingTicks);
+    const double blockPeriodMs = 1000.0 * blockSize / sampleRate;
+
+    std::printf("Rendered %.2f s at %.0f Hz, block size %d\n", audioSeconds, sampleRate, blockSize);
+    std::printf("Processing: %.3f s, %.1fx real time\n", processingSeconds,
+                processingSeconds > 0.0 ? audioSeconds / processingSeconds : 0.0);
+    std::printf("Slowest block: %.3f ms of %.3f ms period\n",
+                1000.0 * juce::Time::highResolutionTicksToSeconds(slowestBlockTicks), blockPeriodMs);
+    std::printf("Trigger events: %d%s\n", static_cast<int>(events.size()),
+                droppedEvents > 0 ? juce::String(" (" + juce::String(droppedEvents) + " dropped)").toRawUTF8() : "");
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+// Everything the analysis stages need about one analysis window, computed once
+// per hop by AudioAnalyzer and shared read-only by the note, chord and melody
+// stages (and ChordDetector). All storage is sized in prepare(), so filling a
+// frame on the audio thread never allocates.
+struct AnalysisFrame
+{
+    // Time domain
+    std::vector<float> monoSamples;      // Analysis window, oldest sample first
+    float rms = 0.0f;
+
+    // Frequency domain
+    std::vector<float> magnitudes;       // |FFT| of the windowed samples, fftSize / 2 + 1 bins
+    std::vector<float> peakFrequencies;  // Spectral peaks in Hz, strongest first
+    std::vector<float> peakMagnitudes;
+    int fftSize = 0;
+    int maxPeaks = 0;
+    double sampleRate = 44100.0;
+
+    // Pitch, detected once and reused by every stage (MIDI note, -1 if none)
+    float pitch = -1.0f;
+
+    void prepare(int windowSize, int newFftSize, int newMaxPeaks, double newSampleRate)
+    {
+        monoSamples.assign(windowSize, 0.0f);
+        magnitudes.assign(newFftSize / 2 + 1, 0.0f);
+        peakFrequencies.clear();
+        peakFrequencies.reserve(newMaxPeaks);
+        peakMagnitudes.clear();
+        peakMagnitudes.reserve(newMaxPeaks);
+        fftSize = newFftSize;
+        maxPeaks = newMaxPeaks;
+        sampleRate = newSampleRate;
+        rms = 0.0f;
+        pitch = -1.0f;
+    }
+
+    float binToFrequency(float bin) const
+    {
+        return fftSize > 0 ? static_cast<float>(bin * sampleRate / fftSize) : 0.0f;
+    }
+};
@@ -0,0 +1,297 @@
+#include "AnalysisThread.h"
+#include "AudioAnalyzer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // Largest hop AudioAnalyzer accepts (its window size is clamped to 8192)
+    constexpr int maxChunkSize = 8192;
+
+    juce::uint64 packChordState(int chordId, float score)
+    {
+        juce::uint32 scoreBits = 0;
+        std::memcpy(&scoreBits, &score, sizeof(scoreBits));
+        return (static_cast<juce::uint64>(static_cast<juce::uint32>(chordId)) << 32) | scoreBits;
+    }
+}
+
+AnalysisThread::AnalysisThread(AudioAnalyzer& analyzerToRun)
+    : juce::Thread("ToneTrigger Analysis"), analyzer(analyzerToRun)
+{
+}
+
+AnalysisThread::~AnalysisThread()
+{
+    stopThread(1000);
+}
+
+void AnalysisThread::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    blockSize = samplesPerBlockExpected;
+
+    // Room for a quarter of a second of audio, or several device blocks,
+    // so a briefly descheduled worker doesn't lose samples
+    const int capacity = juce::nextPowerOfTwo(juce::jmax(static_cast<int>(sampleRate * 0.25),
+                                                          8 * samplesPerBlockExpected,
+                                                          2 * maxChunkSize));
+    fifoBuffer.assign(capacity, 0.0f);
+    fifo.setTotalSize(capacity);
+    fifo.reset();
+
+    // A stamp per push; enough for the FIFO to fill with blocks a quarter of
+    // the expected size, as a host splitting its callbacks might send
+    const int stampCapacity = 4 * capacity / juce::jmax(1, samplesPerBlockExpected) + 16;
+    stampBuffer.assign(static_cast<size_t>(stampCapacity), PushStamp());
+    stampFifo.setTotalSize(stampCapacity);
+    stampFifo.reset();
+    samplesPushed = 0;
+    samplesRead = 0;
+
+    workBuffer.setSize(1, maxChunkSize);
+    workBuffer.clear();
+
+    publishedNote.store(-1.0f);
+    publishedChord.store(packChordState(-1, 0.0f));
+    publishedMelody.store(-1.0f);
+    publishedAmplitude.store(0.0f);
+    resetLatencyStatistics();
+
+    noteEventBuffer.assign(noteEventCapacity, -1);
+    noteEventFifo.reset();
+    lastPublishedEventSerial = analyzer.getMelodyDetector().getNumEvents();
+}
+
+void AnalysisThread::releaseResources()
+{
+    fifo.reset();
+    fifoBuffer.clear();
+    stampFifo.reset();
+    stampBuffer.clear();
+    noteEventFifo.reset();
+    workBuffer.setSize(0, 0);
+}
+
+void AnalysisThread::pushAudio(const juce::AudioBuffer<float>& buffer, float gain)
+{
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+
+    if (numChannels == 0 || numSamples == 0 || fifoBuffer.empty())
+        return;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    const float channelScale = gain / numChannels;
+
+    auto downmix = [&](int sourceStart, int destStart, int count)
+    {
+        float* dest = fifoBuffer.data() + destStart;
+        for (int sample = 0; sample < count; ++sample)
+        {
+            float sum = 0.0f;
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                sum += buffer.getSample(channel, sourceStart + sample);
+            }
+            dest[sample] = sum * channelScale;
+        }
+    };
+
+    if (size1 > 0)
+        downmix(0, start1, size1);
+    if (size2 > 0)
+        downmix(size1, start2, size2);
+
+    const int numWritten = size1 + size2;
+
+    if (numWritten < numSamples)
+        droppedSamples.fetch_add(numSamples - numWritten, std::memory_order_relaxed);
+
+    if (numWritten == 0)
+        return;
+
+    // Stamp the block before releasing its samples, so the worker never reads
+    // a chunk whose stamp isn't there yet. If the worker is so far behind that
+    // the stamps fill up, its next hops are timed from a later block.
+    samplesPushed += numWritten;
+
+    stampFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 > 0)
+    {
+        stampBuffer[static_cast<size_t>(start1)] = { samplesPushed, juce::Time::getHighResolutionTicks() };
+        stampFifo.finishedWrite(1);
+    }
+
+    fifo.finishedWrite(numWritten);
+}
+
+bool AnalysisThread::popNoteEvent(int& note)
+{
+    int start1, size1, start2, size2;
+    noteEventFifo.prepareToRead(1, start1, size1, start2, size2);
+
+    if (size1 < 1)
+        return false;
+
+    note = noteEventBuffer[static_cast<size_t>(start1)];
+    noteEventFifo.finishedRead(1);
+    return true;
+}
+
+float AnalysisThread::getCurrentChord() const
+{
+    const int chordId = getCurrentChordState().chordId;
+    return chordId >= 0 ? static_cast<float>(chordId % 12) : -1.0f;
+}
+
+AnalysisThread::ChordState AnalysisThread::getCurrentChordState() const
+{
+    const juce::uint64 packed = publishedChord.load(std::memory_order_acquire);
+    const auto scoreBits = static_cast<juce::uint32>(packed & 0xffffffffu);
+
+    ChordState state;
+    state.chordId = static_cast<int>(static_cast<juce::uint32>(packed >> 32));
+    std::memcpy(&state.score, &scoreBits, sizeof(state.score));
+    return state;
+}
+
+double AnalysisThread::getLatencyBoundMs() const
+{
+    // The completing block can be waiting out one worker sleep, then every hop
+    // it completed is analysed before the last one's results go out. Sleeps
+    // are as long as measured, or the interval asked for before any were.
+    const int hop = juce::jmin(analyzer.getAnalysisHopSize(), maxChunkSize);
+    const int hopsPerBlock = (blockSize + hop - 1) / hop;
+    const double pollMs = juce::jmax(static_cast<double>(pollIntervalMs), maxPollMs.load(std::memory_order_relaxed));
+    return pollMs + hopsPerBlock * maxAnalysisMs.load(std::memory_order_relaxed);
+}
+
+void AnalysisThread::resetLatencyStatistics()
+{
+    lastLatencyMs.store(0.0, std::memory_order_relaxed);
+    maxLatencyMs.store(0.0, std::memory_order_relaxed);
+    maxAnalysisMs.store(0.0, std::memory_order_relaxed);
+    maxPollMs.store(0.0, std::memory_order_relaxed);
+    droppedSamples.store(0, std::memory_order_relaxed);
+}
+
+void AnalysisThread::run()
+{
+    while (!threadShouldExit())
+    {
+        // Drain everything that's ready, then sleep; the audio thread never
+        // signals us so pushing stays free of system calls
+        if (processPendingAudio())
+            continue;
+
+        const juce::int64 sleepStart = juce::Time::getHighResolutionTicks();
+        wait(pollIntervalMs);
+
+        const double sleptMs = 1000.0 * juce::Time::highResolutionTicksToSeconds(
+            juce::Time::getHighResolutionTicks() - sleepStart);
+        if (sleptMs > maxPollMs.load(std::memory_order_relaxed))
+            maxPollMs.store(sleptMs, std::memory_order_relaxed);
+    }
+}
+
+void AnalysisThread::setPollInterval(int milliseconds)
+{
+    pollIntervalMs = juce::jlimit(1, 20, milliseconds);
+}
+
+bool AnalysisThread::processPendingAudio()
+{
+    const int chunkSize = juce::jmin(analyzer.getAnalysisHopSize(), maxChunkSize);
+
+    if (fifo.getNumReady() < chunkSize)
+        return false;
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(chunkSize, start1, size1, start2, size2);
+
+    // Shrinking the buffer keeps its allocation
+    workBuffer.setSize(1, size1 + size2, false, false, true);
+    float* dest = workBuffer.getWritePointer(0);
+
+    std::copy(fifoBuffer.data() + start1, fifoBuffer.data() + start1 + size1, dest);
+    if (size2 > 0)
+        std::copy(fifoBuffer.data() + start2, fifoBuffer.data() + start2 + size2, dest + size1);
+
+    fifo.finishedRead(size1 + size2);
+    samplesRead += size1 + size2;
+
+    const juce::int64 pushTicks = findCompletingPushTicks(samplesRead);
+
+    const juce::int64 analysisStart = juce::Time::getHighResolutionTicks();
+    analyzer.processAudio(workBuffer);
+
+    const double analysisMs = 1000.0 * juce::Time::highResolutionTicksToSeconds(
+        juce::Time::getHighResolutionTicks() - analysisStart);
+    if (analysisMs > maxAnalysisMs.load(std::memory_order_relaxed))
+        maxAnalysisMs.store(analysisMs, std::memory_order_relaxed);
+
+    publishResults(pushTicks);
+
+    return true;
+}
+
+juce::int64 AnalysisThread::findCompletingPushTicks(juce::int64 chunkEndSample)
+{
+    // Stamps of blocks that ended before the chunk did are done with. The
+    // first one ending at or after it is the block that completed the chunk;
+    // it stays queued as it may complete the next chunk too.
+    while (stampFifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        stampFifo.prepareToRead(1, start1, size1, start2, size2);
+
+        const auto& stamp = stampBuffer[static_cast<size_t>(start1)];
+        if (stamp.endSample >= chunkEndSample)
+            return stamp.ticks;
+
+        stampFifo.finishedRead(1);
+    }
+
+    return 0;
+}
+
+void AnalysisThread::publishResults(juce::int64 pushTicks)
+{
+    publishedAmplitude.store(analyzer.getCurrentAmplitude(), std::memory_order_release);
+    publishedNote.store(analyzer.getCurrentNote(), std::memory_order_release);
+    publishedChord.store(packChordState(analyzer.getCurrentChordId(), analyzer.getCurrentChordScore()),
+                         std::memory_order_release);
+    publishedMelody.store(analyzer.getCurrentMelody(), std::memory_order_release);
+
+    // Every event since the last hop, oldest first (usually none or one)
+    const auto& melodyDetector = analyzer.getMelodyDetector();
+    const juce::uint32 serial = melodyDetector.getNumEvents();
+    const int numNewEvents = static_cast<int>(juce::jmin(serial - lastPublishedEventSerial,
+                                                         static_cast<juce::uint32>(melodyDetector.getNumStoredEvents())));
+    lastPublishedEventSerial = serial;
+
+    for (int i = numNewEvents - 1; i >= 0; --i)
+    {
+        int start1, size1, start2, size2;
+        noteEventFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 < 1)
+            break;
+
+        noteEventBuffer[static_cast<size_t>(start1)] = melodyDetector.getEvent(i).note;
+        noteEventFifo.finishedWrite(1);
+    }
+
+    if (pushTicks > 0)
+    {
+        const double latency = 1000.0 * juce::Time::highResolutionTicksToSeconds(
+            juce::Time::getHighResolutionTicks() - pushTicks);
+
+        lastLatencyMs.store(latency, std::memory_order_relaxed);
+        if (latency > maxLatencyMs.load(std::memory_order_relaxed))
+            maxLatencyMs.store(latency, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+#include <vector>
+
+class AudioAnalyzer;
+
+// Runs an AudioAnalyzer off the audio callback. The audio thread only downmixes
+// into a lock-free single-producer/single-consumer FIFO; the worker drains it in
+// hop-sized chunks and publishes the latest results through atomics, and every
+// note event through a second FIFO so a burst of hops doesn't lose any.
+class AnalysisThread : public juce::Thread
+{
+public:
+    explicit AnalysisThread(AudioAnalyzer& analyzer);
+    ~AnalysisThread() override;
+
+    // Setup (call while the thread is stopped)
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    void releaseResources();
+
+    // Audio thread: never blocks, drops samples if the worker falls behind.
+    // The gain is applied in the downmix.
+    void pushAudio(const juce::AudioBuffer<float>& buffer, float gain = 1.0f);
+
+    // Published analysis results (safe from any thread)
+    float getCurrentNote() const { return publishedNote.load(std::memory_order_acquire); }
+    float getCurrentChord() const; // Root pitch class of the current chord, -1 for none
+    float getCurrentMelody() const { return publishedMelody.load(std::memory_order_acquire); }
+    float getCurrentAmplitude() const { return publishedAmplitude.load(std::memory_order_acquire); }
+
+    // The chord id and its score, published as one value so they always match
+    struct ChordState
+    {
+        int chordId = -1;
+        float score = 0.0f;
+    };
+    ChordState getCurrentChordState() const;
+
+    // Audio thread: the next note event the worker found, oldest first
+    bool popNoteEvent(int& note);
+
+    // Latency statistics: time from the block that completed a hop entering the
+    // FIFO until the results computed from that hop are visible to checkTriggers.
+    // The bound covers the same interval: the longest worker sleep plus analysing
+    // every hop a single block can complete, at the slowest hop analysis seen
+    // so far. Waiting for a hop to fill is audio-domain delay and is in neither.
+    double getLastLatencyMs() const { return lastLatencyMs.load(std::memory_order_relaxed); }
+    double getMaxLatencyMs() const { return maxLatencyMs.load(std::memory_order_relaxed); }
+    double getMaxAnalysisMs() const { return maxAnalysisMs.load(std::memory_order_relaxed); }
+    double getMaxPollMs() const { return maxPollMs.load(std::memory_order_relaxed); } // Sleeps overrun the interval
+    double getLatencyBoundMs() const;
+    int getNumDroppedSamples() const { return droppedSamples.load(std::memory_order_relaxed); }
+    void resetLatencyStatistics();
+
+    // Worker
+    void run() override;
+    void setPollInterval(int milliseconds);
+
+private:
+    AudioAnalyzer& analyzer;
+
+    // Audio parameters
+    double sampleRate = 44100.0;
+    int blockSize = 256;
+    int pollIntervalMs = 1;
+
+    // Audio thread -> worker
+    juce::AbstractFifo fifo { 1 };
+    std::vector<float> fifoBuffer;
+    std::atomic<int> droppedSamples { 0 };
+
+    // Audio thread -> worker push times: where each pushed block ends in the
+    // sample stream and when it went in, so a hop is timed from the block
+    // that completed it
+    struct PushStamp
+    {
+        juce::int64 endSample = 0;
+        juce::int64 ticks = 0;
+    };
+    juce::AbstractFifo stampFifo { 1 };
+    std::vector<PushStamp> stampBuffer;
+    juce::int64 samplesPushed = 0; // Audio thread only
+    juce::int64 samplesRead = 0;   // Worker only
+
+    // Worker scratch
+    juce::AudioBuffer<float> workBuffer;
+
+    // Worker -> any thread
+    std::atomic<float> publishedNote { -1.0f };
+    std::atomic<juce::uint64> publishedChord { 0xffffffff00000000ull }; // Chord id (high half), score bits (low half)
+    std::atomic<float> publishedMelody { -1.0f };
+    std::atomic<float> publishedAmplitude { 0.0f };
+    std::atomic<double> lastLatencyMs { 0.0 };
+    std::atomic<double> maxLatencyMs { 0.0 };
+    std::atomic<double> maxAnalysisMs { 0.0 };
+    std::atomic<double> maxPollMs { 0.0 };
+
+    // Worker -> audio thread note events. The audio thread drains it every
+    // callback, so it only fills (and drops new events) if callbacks stop.
+    static constexpr int noteEventCapacity = 64;
+    juce::AbstractFifo noteEventFifo { noteEventCapacity };
+    std::vector<int> noteEventBuffer;
+    juce::uint32 lastPublishedEventSerial = 0; // Worker only
+
+    // Helper methods
+    bool processPendingAudio();
+    juce::int64 findCompletingPushTicks(juce::int64 chunkEndSample);
+    void publishResults(juce::int64 pushTicks);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisThread)
+};
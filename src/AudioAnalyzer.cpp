@@ -1,9 +1,11 @@
 #include "AudioAnalyzer.h"
+#include "Utils/AudioUtils.h"
 #include <cmath>
 #include <algorithm>
 
 AudioAnalyzer::AudioAnalyzer()
 {
+    chordTracker.prepare(chordDetector.getNumChordIds(), maxChordSmoothingLag);
 }
 
 AudioAnalyzer::~AudioAnalyzer()
@@ -15,40 +17,77 @@ void AudioAnalyzer::prepareToPlay(int samplesPerBlockExpected, double sampleRate
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
     
-    // Initialize analysis buffer
-    analysisBuffer.resize(analysisWindowSize);
-    std::fill(analysisBuffer.begin(), analysisBuffer.end(), 0.0f);
+    // Initialize analysis ring buffer and the shared analysis frame
+    resetAnalysisBuffer();
+    prepareAnalysisFrame();
+    
+    // Preallocate FFT work buffers for the pitch detector
+    noteDetector.prepareToPlay(analysisWindowSize, sampleRate);
+    
+    // Preallocate all scratch storage so the real-time path never allocates
+    autocorrelationBuffer.assign(maxAutocorrelationLag, 0.0f);
+    
+    chordDetector.prepareToPlay(sampleRate);
+    chordDetector.setDetectionThreshold(chordThreshold);
+    chordTracker.prepare(chordDetector.getNumChordIds(), maxChordSmoothingLag);
+    melodyDetector.prepareToPlay(sampleRate);
+    samplesProcessed = 0;
+    currentChordId = -1;
+    currentChordScore = 0.0f;
     
     // Initialize history buffers
     noteHistory.clear();
+    noteHistory.reserve(noteHistorySize);
     amplitudeHistory.clear();
+    amplitudeHistory.reserve(amplitudeHistorySize);
 }
 
 void AudioAnalyzer::releaseResources()
 {
     analysisBuffer.clear();
+    autocorrelationBuffer.clear();
+    chordDetector.releaseResources();
+    spectrumFFT.reset();
+    spectrumBuffer.clear();
+    spectrumWindow.clear();
+    noteDetector.releaseResources();
+    melodyDetector.releaseResources();
     noteHistory.clear();
     amplitudeHistory.clear();
 }
 
-void AudioAnalyzer::processAudio(const juce::AudioBuffer<float>& buffer)
+void AudioAnalyzer::processAudio(const juce::AudioBuffer<float>& buffer, float gain)
 {
-    analyzeAmplitude(buffer);
+    analyzeAmplitude(buffer, gain);
+    
+    // Keep accumulating even when quiet so the window is full once the signal returns
+    writeToAnalysisBuffer(buffer, gain);
     
     // Only analyze if there's sufficient amplitude
     if (currentAmplitude > noteThreshold)
     {
-        analyzeNote(buffer);
-        analyzeChord(buffer);
-        analyzeMelody(buffer);
+        // Build the frame once per hop over the last analysisWindowSize samples,
+        // then let every stage read from it
+        if (isAnalysisWindowReady())
+        {
+            buildAnalysisFrame();
+            analyzeNote(frame);
+            analyzeChord(frame);
+            analyzeMelody(frame);
+        }
     }
     else
     {
         // Reset detections if no signal
         currentNote = -1.0f;
         currentChord = -1.0f;
+        currentChordId = -1;
+        chordTracker.reset();
+        melodyDetector.processFrame(-1.0f, currentAmplitude, samplesProcessed);
         currentMelody = -1.0f;
     }
+    
+    samplesProcessed += buffer.getNumSamples();
 }
 
 void AudioAnalyzer::setNoteDetectionThreshold(float threshold)
@@ -59,6 +98,7 @@ void AudioAnalyzer::setNoteDetectionThreshold(float threshold)
 void AudioAnalyzer::setChordDetectionThreshold(float threshold)
 {
     chordThreshold = juce::jlimit(0.0f, 1.0f, threshold);
+    chordDetector.setDetectionThreshold(chordThreshold);
 }
 
 void AudioAnalyzer::setMelodyDetectionThreshold(float threshold)
@@ -66,91 +106,111 @@ void AudioAnalyzer::setMelodyDetectionThreshold(float threshold)
     melodyThreshold = juce::jlimit(0.0f, 1.0f, threshold);
 }
 
+void AudioAnalyzer::setSpectralPeakThreshold(float threshold)
+{
+    spectralPeakThreshold = juce::jlimit(0.0f, 1.0f, threshold);
+}
+
 void AudioAnalyzer::setAnalysisWindowSize(int windowSize)
 {
     analysisWindowSize = juce::jlimit(256, 8192, windowSize);
-    analysisBuffer.resize(analysisWindowSize);
+    hopSize = std::min(hopSize, analysisWindowSize);
+    resetAnalysisBuffer();
+    prepareAnalysisFrame();
+    noteDetector.prepareToPlay(analysisWindowSize, sampleRate);
 }
 
-void AudioAnalyzer::analyzeNote(const juce::AudioBuffer<float>& buffer)
+void AudioAnalyzer::setAnalysisHopSize(int newHopSize)
 {
-    // Simple pitch detection using autocorrelation
-    // In a real implementation, you'd want more sophisticated algorithms
-    
-    // Convert buffer to mono for analysis
-    std::vector<float> monoBuffer(buffer.getNumSamples());
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-    {
-        float sum = 0.0f;
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
-            sum += buffer.getSample(channel, sample);
-        }
-        monoBuffer[sample] = sum / buffer.getNumChannels();
-    }
-    
-    float detectedPitch = detectPitch(monoBuffer);
+    hopSize = juce::jlimit(32, analysisWindowSize, newHopSize);
+}
+
+void AudioAnalyzer::setPitchDetectionMethod(PitchDetectionMethod method)
+{
+    pitchDetectionMethod = method;
+}
+
+void AudioAnalyzer::setChordSmoothingEnabled(bool enabled)
+{
+    chordSmoothingEnabled = enabled;
+    chordTracker.reset();
+}
+
+void AudioAnalyzer::setChordSmoothingLag(int hops)
+{
+    chordTracker.setLag(juce::jlimit(0, maxChordSmoothingLag, hops));
+}
+
+void AudioAnalyzer::analyzeNote(const AnalysisFrame& analysisFrame)
+{
+    float detectedPitch = analysisFrame.pitch;
     
     if (detectedPitch > 0)
     {
         currentNote = detectedPitch;
-        updateHistory(noteHistory, detectedPitch, 10);
+        updateHistory(noteHistory, detectedPitch, noteHistorySize);
     }
 }
 
-void AudioAnalyzer::analyzeChord(const juce::AudioBuffer<float>& buffer)
+void AudioAnalyzer::analyzeChord(const AnalysisFrame& analysisFrame)
 {
-    // Simple chord detection based on harmonic content
-    // In a real implementation, you'd want more sophisticated chord recognition
+    // Chroma template matching on the frame's spectral peaks; only the integer
+    // id is kept here, names are looked up when something asks for them
+    const int detectedChordId = chordDetector.detectChordId(analysisFrame);
+    currentChordScore = chordDetector.getLastChordScore();
     
-    std::vector<float> monoBuffer(buffer.getNumSamples());
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+    // The tracker is sized for the vocabulary at prepareToPlay; if the
+    // database changed since, pass raw decisions through until re-prepared
+    if (chordSmoothingEnabled && chordTracker.getNumChordIds() == chordDetector.getNumChordIds())
     {
-        float sum = 0.0f;
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
-            sum += buffer.getSample(channel, sample);
-        }
-        monoBuffer[sample] = sum / buffer.getNumChannels();
+        if (const float* scores = chordDetector.getChordScores())
+            currentChordId = chordTracker.processFrame(scores);
+        else
+            currentChordId = chordTracker.processFrame(detectedChordId, currentChordScore);
     }
-    
-    auto harmonics = detectHarmonics(monoBuffer);
-    
-    if (!harmonics.empty())
+    else
     {
-        // Use the strongest harmonic as chord root
-        currentChord = harmonics[0];
+        currentChordId = detectedChordId;
     }
+    
+    currentChord = static_cast<float>(chordDetector.getChordRoot(currentChordId));
 }
 
-void AudioAnalyzer::analyzeMelody(const juce::AudioBuffer<float>& buffer)
+void AudioAnalyzer::analyzeMelody(const AnalysisFrame& analysisFrame)
 {
-    // Simple melody detection based on note history
-    // In a real implementation, you'd want more sophisticated melody tracking
+    // Segment the pitch track into note events; the melody is the note
+    // currently sounding, and triggers consume the events themselves
+    melodyDetector.processFrame(analysisFrame.pitch, analysisFrame.rms, samplesProcessed);
     
-    if (!noteHistory.empty())
-    {
-        // Use the most recent note as current melody
-        currentMelody = noteHistory.back();
-    }
+    const int note = melodyDetector.getCurrentNote();
+    currentMelody = note >= 0 ? static_cast<float>(note) : -1.0f;
 }
 
-void AudioAnalyzer::analyzeAmplitude(const juce::AudioBuffer<float>& buffer)
+void AudioAnalyzer::analyzeAmplitude(const juce::AudioBuffer<float>& buffer, float gain)
 {
-    currentAmplitude = calculateRMS(buffer);
-    updateHistory(amplitudeHistory, currentAmplitude, 20);
+    currentAmplitude = calculateRMS(buffer) * std::abs(gain);
+    updateHistory(amplitudeHistory, currentAmplitude, amplitudeHistorySize);
 }
 
 float AudioAnalyzer::detectPitch(const std::vector<float>& buffer)
+{
+    if (pitchDetectionMethod == PitchDetectionMethod::FFTAutocorrelation)
+        return noteDetector.detectPitch(buffer.data(), static_cast<int>(buffer.size()));
+    
+    return detectPitchAutocorrelation(buffer);
+}
+
+float AudioAnalyzer::detectPitchAutocorrelation(const std::vector<float>& buffer)
 {
     // Simple autocorrelation-based pitch detection
-    // This is a basic implementation - real applications would use more sophisticated algorithms
+    // Kept as a reference path to compare against the FFT detector
     
     if (buffer.size() < 512)
         return -1.0f;
     
-    const int maxLag = std::min(static_cast<int>(buffer.size() / 2), 2048);
-    std::vector<float> autocorr(maxLag);
+    const int maxLag = std::min(static_cast<int>(buffer.size() / 2),
+                                static_cast<int>(autocorrelationBuffer.size()));
+    auto& autocorr = autocorrelationBuffer;
     
     // Calculate autocorrelation
     for (int lag = 0; lag < maxLag; ++lag)
@@ -191,23 +251,6 @@ float AudioAnalyzer::detectPitch(const std::vector<float>& buffer)
     return -1.0f;
 }
 
-std::vector<float> AudioAnalyzer::detectHarmonics(const std::vector<float>& buffer)
-{
-    // Simple harmonic detection using FFT
-    // In a real implementation, you'd use JUCE's FFT class
-    
-    std::vector<float> harmonics;
-    
-    // For now, just return the fundamental frequency
-    float fundamental = detectPitch(buffer);
-    if (fundamental > 0)
-    {
-        harmonics.push_back(fundamental);
-    }
-    
-    return harmonics;
-}
-
 float AudioAnalyzer::calculateRMS(const juce::AudioBuffer<float>& buffer)
 {
     float sum = 0.0f;
@@ -225,11 +268,184 @@ float AudioAnalyzer::calculateRMS(const juce::AudioBuffer<float>& buffer)
     return std::sqrt(sum / totalSamples);
 }
 
-void AudioAnalyzer::updateHistory(std::deque<float>& history, float value, int maxSize)
+void AudioAnalyzer::resetAnalysisBuffer()
 {
-    history.push_back(value);
-    if (history.size() > maxSize)
+    analysisBuffer.assign(analysisWindowSize, 0.0f);
+    analysisWritePosition = 0;
+    samplesAccumulated = 0;
+    samplesSinceLastAnalysis = 0;
+}
+
+void AudioAnalyzer::writeToAnalysisBuffer(const juce::AudioBuffer<float>& buffer, float gain)
+{
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+    const int bufferSize = static_cast<int>(analysisBuffer.size());
+    
+    if (numChannels == 0 || bufferSize == 0)
+        return;
+    
+    // Downmix straight into the ring, gain included; the write position wraps
+    // so device blocks of any size build up one analysisWindowSize window
+    const float channelScale = gain / numChannels;
+    
+    for (int sample = 0; sample < numSamples; ++sample)
     {
-        history.pop_front();
+        float sum = 0.0f;
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            sum += buffer.getSample(channel, sample);
+        }
+        
+        analysisBuffer[analysisWritePosition] = sum * channelScale;
+        
+        if (++analysisWritePosition == bufferSize)
+            analysisWritePosition = 0;
     }
-} 
\ No newline at end of file
+    
+    samplesAccumulated = std::min(samplesAccumulated + numSamples, bufferSize);
+    samplesSinceLastAnalysis += numSamples;
+}
+
+bool AudioAnalyzer::isAnalysisWindowReady() const
+{
+    return samplesAccumulated >= static_cast<int>(analysisBuffer.size())
+        && samplesSinceLastAnalysis >= hopSize;
+}
+
+void AudioAnalyzer::readAnalysisWindow()
+{
+    // Unwrap the ring oldest-sample-first into the frame's analysis window
+    auto& window = frame.monoSamples;
+    const int tail = static_cast<int>(analysisBuffer.size()) - analysisWritePosition;
+    
+    std::copy(analysisBuffer.begin() + analysisWritePosition, analysisBuffer.end(), window.begin());
+    std::copy(analysisBuffer.begin(), analysisBuffer.begin() + analysisWritePosition, window.begin() + tail);
+    
+    samplesSinceLastAnalysis = 0;
+}
+
+void AudioAnalyzer::prepareAnalysisFrame()
+{
+    int order = 0;
+    while ((1 << order) < analysisWindowSize)
+        ++order;
+    
+    const int fftSize = 1 << order;
+    spectrumFFT = std::make_unique<juce::dsp::FFT>(order);
+    spectrumBuffer.assign(2 * fftSize, 0.0f);
+    
+    spectrumWindow = AudioUtils::createHannWindow(analysisWindowSize);
+    float windowSum = 0.0f;
+    for (float w : spectrumWindow)
+        windowSum += w;
+    
+    // Scale so a full-scale sinusoid reads as magnitude 1
+    spectrumWindowGain = windowSum > 0.0f ? 2.0f / windowSum : 1.0f;
+    
+    frame.prepare(analysisWindowSize, fftSize, maxSpectralPeaks, sampleRate);
+}
+
+void AudioAnalyzer::buildAnalysisFrame()
+{
+    readAnalysisWindow();
+    
+    const auto& window = frame.monoSamples;
+    
+    float sum = 0.0f;
+    for (float sample : window)
+        sum += sample * sample;
+    frame.rms = window.empty() ? 0.0f : std::sqrt(sum / window.size());
+    
+    // The expensive parts are done exactly once per frame
+    frame.pitch = detectPitch(window);
+    computeSpectrum();
+    findSpectralPeaks();
+}
+
+void AudioAnalyzer::computeSpectrum()
+{
+    if (!spectrumFFT)
+        return;
+    
+    const auto& window = frame.monoSamples;
+    const int numSamples = std::min(static_cast<int>(window.size()), static_cast<int>(spectrumWindow.size()));
+    
+    std::fill(spectrumBuffer.begin(), spectrumBuffer.end(), 0.0f);
+    for (int i = 0; i < numSamples; ++i)
+        spectrumBuffer[i] = window[i] * spectrumWindow[i];
+    
+    spectrumFFT->performFrequencyOnlyForwardTransform(spectrumBuffer.data());
+    
+    const int numBins = static_cast<int>(frame.magnitudes.size());
+    for (int bin = 0; bin < numBins; ++bin)
+        frame.magnitudes[bin] = spectrumBuffer[bin] * spectrumWindowGain;
+}
+
+void AudioAnalyzer::findSpectralPeaks()
+{
+    auto& frequencies = frame.peakFrequencies;
+    auto& magnitudes = frame.peakMagnitudes;
+    const auto& spectrum = frame.magnitudes;
+    const int numBins = static_cast<int>(spectrum.size());
+    
+    frequencies.clear();
+    magnitudes.clear();
+    
+    // Only search the range a guitar's fundamentals and low partials live in
+    const float binsPerHz = frame.fftSize / static_cast<float>(frame.sampleRate);
+    const int firstBin = std::max(1, static_cast<int>(minPeakFrequency * binsPerHz));
+    const int lastBin = std::min(numBins - 1, static_cast<int>(maxPeakFrequency * binsPerHz) + 1);
+    
+    float maxMagnitude = 0.0f;
+    for (int bin = firstBin; bin < lastBin; ++bin)
+        maxMagnitude = std::max(maxMagnitude, spectrum[bin]);
+    
+    const float floor = std::max(maxMagnitude * spectralPeakThreshold, 1.0e-4f);
+    
+    for (int bin = firstBin; bin < lastBin; ++bin)
+    {
+        if (spectrum[bin] < floor || spectrum[bin] <= spectrum[bin - 1] || spectrum[bin] < spectrum[bin + 1])
+            continue;
+        
+        // Parabolic interpolation on log magnitudes; for a Hann window this
+        // brings the frequency estimate well inside a bin
+        const float left = std::log(spectrum[bin - 1] + 1.0e-12f);
+        const float centre = std::log(spectrum[bin] + 1.0e-12f);
+        const float right = std::log(spectrum[bin + 1] + 1.0e-12f);
+        const float denominator = left - 2.0f * centre + right;
+        const float offset = std::abs(denominator) > 1.0e-12f
+                           ? juce::jlimit(-0.5f, 0.5f, 0.5f * (left - right) / denominator)
+                           : 0.0f;
+        const float magnitude = std::exp(centre - 0.25f * (left - right) * offset);
+        
+        // Keep the list sorted strongest-first and bounded by maxPeaks,
+        // inserting within the reserved capacity
+        int position = static_cast<int>(magnitudes.size());
+        while (position > 0 && magnitudes[position - 1] < magnitude)
+            --position;
+        
+        if (position >= frame.maxPeaks)
+            continue;
+        
+        if (static_cast<int>(magnitudes.size()) == frame.maxPeaks)
+        {
+            frequencies.pop_back();
+            magnitudes.pop_back();
+        }
+        
+        frequencies.insert(frequencies.begin() + position, frame.binToFrequency(bin + offset));
+        magnitudes.insert(magnitudes.begin() + position, magnitude);
+    }
+}
+
+void AudioAnalyzer::updateHistory(std::vector<float>& history, float value, int maxSize)
+{
+    // Histories are tiny and reserved up front, so shifting beats a deque
+    // whose node allocations would land on the audio thread
+    if (static_cast<int>(history.size()) >= maxSize)
+    {
+        history.erase(history.begin());
+    }
+    history.push_back(value);
+}
@@ -1,8 +1,14 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include "NoteDetector.h"
+#include "ChordDetector.h"
+#include "ChordTracker.h"
+#include "MelodyDetector.h"
+#include "AnalysisFrame.h"
+#include <memory>
 #include <vector>
-#include <deque>
 
 class AudioAnalyzer
 {
@@ -14,32 +20,69 @@ public:
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
     void releaseResources();
 
-    // Audio processing
-    void processAudio(const juce::AudioBuffer<float>& buffer);
+    // Audio processing. The gain is applied as the block is read, so callers
+    // don't need to scale the buffer first.
+    void processAudio(const juce::AudioBuffer<float>& buffer, float gain = 1.0f);
 
     // Analysis results
     float getCurrentNote() const { return currentNote; }
     float getCurrentChord() const { return currentChord; }
     float getCurrentMelody() const { return currentMelody; }
     float getCurrentAmplitude() const { return currentAmplitude; }
+    const AnalysisFrame& getCurrentFrame() const { return frame; }
+    int getCurrentChordId() const { return currentChordId; }
+    float getCurrentChordScore() const { return currentChordScore; }
+    ChordInfo getCurrentChordInfo() const { return chordDetector.getChordInfo(currentChordId, currentChordScore); }
+    const MelodyDetector& getMelodyDetector() const { return melodyDetector; }
+    ChordDetector& getChordDetector() { return chordDetector; } // Database changes take effect on the next prepareToPlay
 
     // Configuration
     void setNoteDetectionThreshold(float threshold);
     void setChordDetectionThreshold(float threshold);
     void setMelodyDetectionThreshold(float threshold);
+    void setSpectralPeakThreshold(float threshold);
     void setAnalysisWindowSize(int windowSize);
+    void setAnalysisHopSize(int hopSize);
+    int getAnalysisHopSize() const { return hopSize; }
+    void setPitchDetectionMethod(PitchDetectionMethod method);
+    void setChordSmoothingEnabled(bool enabled);
+    void setChordSmoothingLag(int hops);
+    int getChordSmoothingLag() const { return chordTracker.getLag(); }
+    PitchDetectionMethod getPitchDetectionMethod() const { return pitchDetectionMethod; }
 
 private:
     // Audio parameters
     double sampleRate = 44100.0;
     int blockSize = 256;
     int analysisWindowSize = 2048;
+    int hopSize = 512;
 
     // Detection thresholds
     float noteThreshold = 0.1f;
     float chordThreshold = 0.15f;
     float melodyThreshold = 0.1f;
+    float spectralPeakThreshold = 0.05f; // Relative to the strongest bin
+    float minPeakFrequency = 60.0f;      // Below a drop-tuned low string
+    float maxPeakFrequency = 5000.0f;    // Above this it's mostly upper partials
 
+    // Pitch detection
+    PitchDetectionMethod pitchDetectionMethod = PitchDetectionMethod::FFTAutocorrelation;
+    NoteDetector noteDetector;
+
+    // Chord detection
+    ChordDetector chordDetector;
+    int currentChordId = -1;
+    float currentChordScore = 0.0f;
+    
+    // Chord smoothing: decisions lag the newest frame by the tracker's lag in hops
+    static constexpr int maxChordSmoothingLag = 32;
+    ChordTracker chordTracker;
+    bool chordSmoothingEnabled = true;
+
+    // Melody segmentation
+    MelodyDetector melodyDetector;
+    juce::int64 samplesProcessed = 0;
+    
     // Analysis results
     float currentNote = -1.0f;
     float currentChord = -1.0f;
@@ -47,21 +90,50 @@ private:
     float currentAmplitude = 0.0f;
 
     // Analysis buffers
-    std::vector<float> analysisBuffer;
-    std::deque<float> noteHistory;
-    std::deque<float> amplitudeHistory;
+    std::vector<float> analysisBuffer;  // Mono ring accumulating samples across callbacks
+    int analysisWritePosition = 0;
+    int samplesAccumulated = 0;
+    int samplesSinceLastAnalysis = 0;
+    std::vector<float> noteHistory;
+    std::vector<float> amplitudeHistory;
+
+    // Preallocated scratch storage for the real-time path
+    static constexpr int maxAutocorrelationLag = 2048;
+    static constexpr int noteHistorySize = 10;
+    static constexpr int amplitudeHistorySize = 20;
+    std::vector<float> autocorrelationBuffer;
+
+    // Shared per-hop analysis frame and the spectrum that feeds it
+    static constexpr int maxSpectralPeaks = 32;
+    AnalysisFrame frame;
+    std::unique_ptr<juce::dsp::FFT> spectrumFFT;
+    std::vector<float> spectrumBuffer;
+    std::vector<float> spectrumWindow;
+    float spectrumWindowGain = 1.0f;
 
     // Analysis methods
-    void analyzeNote(const juce::AudioBuffer<float>& buffer);
-    void analyzeChord(const juce::AudioBuffer<float>& buffer);
-    void analyzeMelody(const juce::AudioBuffer<float>& buffer);
-    void analyzeAmplitude(const juce::AudioBuffer<float>& buffer);
+    void analyzeNote(const AnalysisFrame& analysisFrame);
+    void analyzeChord(const AnalysisFrame& analysisFrame);
+    void analyzeMelody(const AnalysisFrame& analysisFrame);
+    void analyzeAmplitude(const juce::AudioBuffer<float>& buffer, float gain);
+    
+    // Analysis window accumulation
+    void resetAnalysisBuffer();
+    void writeToAnalysisBuffer(const juce::AudioBuffer<float>& buffer, float gain);
+    bool isAnalysisWindowReady() const;
+    void readAnalysisWindow();
+    
+    // Analysis frame
+    void prepareAnalysisFrame();
+    void buildAnalysisFrame();
+    void computeSpectrum();
+    void findSpectralPeaks();
     
     // Helper methods
     float detectPitch(const std::vector<float>& buffer);
-    std::vector<float> detectHarmonics(const std::vector<float>& buffer);
+    float detectPitchAutocorrelation(const std::vector<float>& buffer);
     float calculateRMS(const juce::AudioBuffer<float>& buffer);
-    void updateHistory(std::deque<float>& history, float value, int maxSize);
+    void updateHistory(std::vector<float>& history, float value, int maxSize);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioAnalyzer)
 }; 
\ No newline at end of file
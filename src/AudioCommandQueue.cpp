@@ -0,0 +1,75 @@
+#include "AudioCommandQueue.h"
+
+AudioCommandQueue::AudioCommandQueue(int capacity)
+    : commandFifo(capacity),
+      retiredFifo(2 * capacity) // Every command retires at most one object
+{
+    commands.resize(capacity);
+    retiredObjects.resize(2 * capacity);
+}
+
+AudioCommandQueue::~AudioCommandQueue()
+{
+    collectGarbage();
+}
+
+bool AudioCommandQueue::push(const AudioCommand& command)
+{
+    int start1, size1, start2, size2;
+    commandFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 < 1)
+        return false;
+
+    commands[size1 > 0 ? start1 : start2] = command;
+    commandFifo.finishedWrite(1);
+    return true;
+}
+
+bool AudioCommandQueue::pop(AudioCommand& command)
+{
+    int start1, size1, start2, size2;
+    commandFifo.prepareToRead(1, start1, size1, start2, size2);
+
+    if (size1 + size2 < 1)
+        return false;
+
+    command = commands[size1 > 0 ? start1 : start2];
+    commandFifo.finishedRead(1);
+    return true;
+}
+
+bool AudioCommandQueue::retireObject(void* object, void (*destroy)(void*))
+{
+    if (object == nullptr)
+        return true;
+
+    int start1, size1, start2, size2;
+    retiredFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    // Leaking is the lesser evil: the audio thread must not free
+    if (size1 + size2 < 1)
+        return false;
+
+    auto& retired = retiredObjects[size1 > 0 ? start1 : start2];
+    retired.object = object;
+    retired.destroy = destroy;
+    retiredFifo.finishedWrite(1);
+    return true;
+}
+
+void AudioCommandQueue::collectGarbage()
+{
+    for (;;)
+    {
+        int start1, size1, start2, size2;
+        retiredFifo.prepareToRead(1, start1, size1, start2, size2);
+
+        if (size1 + size2 < 1)
+            break;
+
+        auto retired = retiredObjects[size1 > 0 ? start1 : start2];
+        retiredFifo.finishedRead(1);
+        retired.destroy(retired.object);
+    }
+}
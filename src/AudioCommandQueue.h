@@ -0,0 +1,67 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// One edit from the message thread to the audio thread. Commands are plain
+// values; anything that needs allocating is built on the message thread and
+// handed over as an owned pointer in payload.
+struct AudioCommand
+{
+    enum class Type
+    {
+        SwapEffectList,      // payload: EffectRenderList*
+        SetEffectEnabled,    // targetId: effect id, value: 0 or 1
+        SetEffectParameter   // targetId: effect id, parameterId, value
+    };
+
+    Type type = Type::SwapEffectList;
+    int lane = 0;         // ProcessingLane whose effects it edits
+    int targetId = -1;
+    int parameterId = 0;
+    float value = 0.0f;
+    void* payload = nullptr;
+};
+
+// Single-producer/single-consumer command queue from the message thread to the
+// audio callback. Objects the audio thread takes out of service travel back
+// through a second FIFO and are destroyed by the message thread, so the
+// callback never frees memory either.
+class AudioCommandQueue
+{
+public:
+    explicit AudioCommandQueue(int capacity = 256);
+    ~AudioCommandQueue();
+
+    // Message thread
+    bool push(const AudioCommand& command); // False when full
+    void collectGarbage();                  // Destroys everything the audio thread retired
+
+    // Audio thread
+    bool pop(AudioCommand& command);
+
+    template <typename ObjectType>
+    bool retire(ObjectType* object)
+    {
+        return retireObject(object, [](void* retired) { delete static_cast<ObjectType*>(retired); });
+    }
+
+private:
+    struct RetiredObject
+    {
+        void* object = nullptr;
+        void (*destroy)(void*) = nullptr;
+    };
+
+    // Message thread -> audio thread
+    juce::AbstractFifo commandFifo;
+    std::vector<AudioCommand> commands;
+
+    // Audio thread -> message thread
+    juce::AbstractFifo retiredFifo;
+    std::vector<RetiredObject> retiredObjects;
+
+    bool retireObject(void* object, void (*destroy)(void*));
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioCommandQueue)
+};
@@ -1,17 +1,26 @@
 #include "AudioProcessor.h"
 #include "TriggerManager.h"
 #include "EffectProcessor.h"
-#include "AudioAnalyzer.h"
+#include "Utils/RealtimeAllocationGuard.h"
 
 AudioProcessor::AudioProcessor()
 {
-    triggerManager = std::make_unique<TriggerManager>();
-    effectProcessor = std::make_unique<EffectProcessor>();
-    audioAnalyzer = std::make_unique<AudioAnalyzer>();
+    for (size_t i = 0; i < lanes.size(); ++i)
+    {
+        lanes[i] = std::make_unique<ProcessingLane>();
+
+        // However the triggers change (here, or on the TriggerManager directly),
+        // the effects they select come out of the always-on chain and back
+        const int lane = static_cast<int>(i);
+        lanes[i]->getTriggerManager()->setTargetsChangedCallback([this, lane] { publishEffectList(lane); });
+    }
 }
 
 AudioProcessor::~AudioProcessor()
 {
+    // Nothing drains the queue any more; apply what's left so every payload is owned
+    processCommands();
+    commandQueue.collectGarbage();
 }
 
 void AudioProcessor::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
@@ -19,32 +28,55 @@ void AudioProcessor::prepareToPlay(int samplesPerBlockExpected, double sampleRat
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
 
-    // Prepare buffers
-    inputBuffer.setSize(2, samplesPerBlockExpected);
-    outputBuffer.setSize(2, samplesPerBlockExpected);
-    tempBuffer.setSize(2, samplesPerBlockExpected);
+    // Latch the layout: linked inputs share one lane, otherwise each input
+    // channel gets a mono lane of its own
+    numActiveLanes = getNumLanes();
+    const bool linked = channelLayout == ChannelLayout::Linked;
+
+    // One worker per job beyond the one the audio thread takes itself, as far
+    // as the cores go; with nothing to spread, everything stays on this thread
+    const int maxJobsPerBatch = linked ? numInputChannels : numActiveLanes;
+    const int numWorkers = parallelProcessing ? juce::jmin(juce::SystemStats::getNumCpus(), maxJobsPerBatch) - 1 : 0;
+
+    if (numWorkers > 0)
+        workerPool.prepare(numWorkers, samplesPerBlockExpected, sampleRate);
+    else
+        workerPool.release();
+
+    for (int i = 0; i < maxLanes; ++i)
+    {
+        auto& lane = *lanes[static_cast<size_t>(i)];
+
+        if (i < numActiveLanes)
+            lane.prepareToPlay(samplesPerBlockExpected, sampleRate, linked ? 0 : i, linked ? numInputChannels : 1,
+                               analysisMode, &workerPool);
+        else if (lane.isPrepared())
+            lane.releaseResources();
+    }
+
+    profiler.prepareToPlay(samplesPerBlockExpected, sampleRate);
 
-    // Prepare components
-    if (triggerManager)
-        triggerManager->prepareToPlay(samplesPerBlockExpected, sampleRate);
-    if (effectProcessor)
-        effectProcessor->prepareToPlay(samplesPerBlockExpected, sampleRate);
-    if (audioAnalyzer)
-        audioAnalyzer->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // From here on the callback owns the queue's consumer side
+    processCommands();
+    audioRunning.store(true, std::memory_order_release);
 }
 
 void AudioProcessor::releaseResources()
 {
-    inputBuffer.setSize(0, 0);
-    outputBuffer.setSize(0, 0);
-    tempBuffer.setSize(0, 0);
+    // Callbacks have stopped, so edits still queued are applied here instead
+    audioRunning.store(false, std::memory_order_release);
+    processCommands();
+    commandQueue.collectGarbage();
 
-    if (triggerManager)
-        triggerManager->releaseResources();
-    if (effectProcessor)
-        effectProcessor->releaseResources();
-    if (audioAnalyzer)
-        audioAnalyzer->releaseResources();
+    for (auto& lane : lanes)
+    {
+        if (lane->isPrepared())
+            lane->releaseResources();
+    }
+
+    numActiveLanes = 0;
+    workerPool.release();
+    profiler.releaseResources();
 }
 
 void AudioProcessor::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
@@ -62,153 +94,343 @@ void AudioProcessor::setOutputGain(float gain)
     outputGain = juce::jlimit(0.0f, 10.0f, gain);
 }
 
-void AudioProcessor::addNoteTrigger(int note, int effectId)
+void AudioProcessor::setChannelLayout(ChannelLayout layout)
 {
-    if (triggerManager)
-        triggerManager->addNoteTrigger(note, effectId);
+    channelLayout = layout;
 }
 
-void AudioProcessor::addChordTrigger(const std::vector<int>& notes, int effectId)
+void AudioProcessor::setNumInputChannels(int numChannels)
 {
-    if (triggerManager)
-        triggerManager->addChordTrigger(notes, effectId);
+    numInputChannels = juce::jmax(1, numChannels);
 }
 
-void AudioProcessor::addMelodyTrigger(const std::vector<int>& sequence, int effectId)
+void AudioProcessor::setParallelProcessing(bool shouldProcessInParallel)
 {
-    if (triggerManager)
-        triggerManager->addMelodyTrigger(sequence, effectId);
+    parallelProcessing = shouldProcessInParallel;
 }
 
-void AudioProcessor::removeTrigger(int triggerId)
+int AudioProcessor::getNumLanes() const
 {
-    if (triggerManager)
-        triggerManager->removeTrigger(triggerId);
+    if (channelLayout == ChannelLayout::Linked)
+        return 1;
+    return juce::jmin(numInputChannels, maxLanes);
 }
 
-void AudioProcessor::setEffectEnabled(int effectId, bool enabled)
+juce::String AudioProcessor::getLaneName(int lane) const
 {
-    if (effectProcessor)
-        effectProcessor->setEffectEnabled(effectId, enabled);
+    if (channelLayout == ChannelLayout::Linked)
+        return "All inputs";
+    return "Input " + juce::String(lane + 1);
 }
 
-void AudioProcessor::setEffectParameter(int effectId, int parameterId, float value)
+int AudioProcessor::addNoteTrigger(int note, int effectId, int lane)
 {
-    if (effectProcessor)
-        effectProcessor->setParameter(effectId, parameterId, value);
+    auto* triggerManager = getTriggerManager(lane);
+    if (!triggerManager)
+        return -1;
+
+    return triggerManager->addNoteTrigger(note, effectId);
+}
+
+int AudioProcessor::addChordTrigger(const std::vector<int>& notes, int effectId, int lane)
+{
+    auto* triggerManager = getTriggerManager(lane);
+    if (!triggerManager)
+        return -1;
+
+    return triggerManager->addChordTrigger(notes, effectId);
+}
+
+int AudioProcessor::addMelodyTrigger(const std::vector<int>& sequence, int effectId, int lane)
+{
+    auto* triggerManager = getTriggerManager(lane);
+    if (!triggerManager)
+        return -1;
+
+    return triggerManager->addMelodyTrigger(sequence, effectId);
+}
+
+void AudioProcessor::removeTrigger(int triggerId, int lane)
+{
+    auto* triggerManager = getTriggerManager(lane);
+    if (!triggerManager)
+        return;
+
+    triggerManager->removeTrigger(triggerId);
 }
 
-bool AudioProcessor::isEffectEnabled(int effectId) const
+const std::vector<Trigger>& AudioProcessor::getTriggers(int lane) const
 {
-    if (effectProcessor)
+    static const std::vector<Trigger> noTriggers;
+
+    auto* triggerManager = getTriggerManager(lane);
+    return triggerManager != nullptr ? triggerManager->getTriggers() : noTriggers;
+}
+
+int AudioProcessor::addEffect(int effectType, int lane)
+{
+    auto* effectProcessor = getEffectProcessor(lane);
+    if (!effectProcessor || effectType < 0 || effectType > static_cast<int>(EffectType::Compressor))
+        return -1;
+
+    const int effectId = effectProcessor->addEffect(static_cast<EffectType>(effectType));
+    if (effectId >= 0)
+        publishEffectList(lane);
+    return effectId;
+}
+
+void AudioProcessor::removeEffect(int effectId, int lane)
+{
+    auto* effectProcessor = getEffectProcessor(lane);
+    if (!effectProcessor || effectProcessor->getEffect(effectId) == nullptr)
+        return;
+
+    effectProcessor->removeEffect(effectId);
+    publishEffectList(lane);
+}
+
+void AudioProcessor::moveEffect(int effectId, int newIndex, int lane)
+{
+    auto* effectProcessor = getEffectProcessor(lane);
+    if (!effectProcessor || effectProcessor->getEffect(effectId) == nullptr)
+        return;
+
+    // The new order goes out as one list, so the callback never sees it half done
+    effectProcessor->moveEffect(effectId, newIndex);
+    publishEffectList(lane);
+}
+
+void AudioProcessor::setEffectEnabled(int effectId, bool enabled, int lane)
+{
+    auto* effectProcessor = getEffectProcessor(lane);
+    if (!effectProcessor)
+        return;
+
+    effectProcessor->setEffectEnabled(effectId, enabled);
+
+    AudioCommand command;
+    command.type = AudioCommand::Type::SetEffectEnabled;
+    command.lane = lane;
+    command.targetId = effectId;
+    command.value = enabled ? 1.0f : 0.0f;
+    postCommand(command);
+}
+
+void AudioProcessor::setEffectParameter(int effectId, int parameterId, float value, int lane)
+{
+    auto* effectProcessor = getEffectProcessor(lane);
+    if (!effectProcessor)
+        return;
+
+    effectProcessor->setParameter(effectId, parameterId, value);
+
+    AudioCommand command;
+    command.type = AudioCommand::Type::SetEffectParameter;
+    command.lane = lane;
+    command.targetId = effectId;
+    command.parameterId = parameterId;
+    command.value = value;
+    postCommand(command);
+}
+
+bool AudioProcessor::isEffectEnabled(int effectId, int lane) const
+{
+    if (auto* effectProcessor = getEffectProcessor(lane))
         return effectProcessor->isEffectEnabled(effectId);
     return false;
 }
 
-float AudioProcessor::getCurrentNote() const
+void AudioProcessor::setAnalysisMode(AnalysisMode mode)
 {
-    if (audioAnalyzer)
-        return audioAnalyzer->getCurrentNote();
+    analysisMode = mode;
+}
+
+float AudioProcessor::getCurrentNote(int lane) const
+{
+    if (auto* processingLane = getLane(lane))
+        return processingLane->getCurrentNote();
     return -1.0f;
 }
 
-float AudioProcessor::getCurrentChord() const
+float AudioProcessor::getCurrentChord(int lane) const
 {
-    if (audioAnalyzer)
-        return audioAnalyzer->getCurrentChord();
+    if (auto* processingLane = getLane(lane))
+        return processingLane->getCurrentChord();
     return -1.0f;
 }
 
-float AudioProcessor::getCurrentMelody() const
+int AudioProcessor::getCurrentChordId(int lane) const
 {
-    if (audioAnalyzer)
-        return audioAnalyzer->getCurrentMelody();
+    if (auto* processingLane = getLane(lane))
+        return processingLane->getCurrentChordId();
+    return -1;
+}
+
+float AudioProcessor::getCurrentMelody(int lane) const
+{
+    if (auto* processingLane = getLane(lane))
+        return processingLane->getCurrentMelody();
     return -1.0f;
 }
 
-void AudioProcessor::processAudio(const juce::AudioSourceChannelInfo& bufferToFill)
+ProcessingLane* AudioProcessor::getLane(int lane) const
 {
-    // Clear output buffer
-    outputBuffer.clear();
+    if (lane < 0 || lane >= maxLanes)
+        return nullptr;
+    return lanes[static_cast<size_t>(lane)].get();
+}
 
-    // Copy input to our working buffer
-    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
-    {
-        const float* inputChannel = bufferToFill.buffer->getReadPointer(channel);
-        float* outputChannel = outputBuffer.getWritePointer(channel);
-        
-        for (int sample = 0; sample < bufferToFill.numSamples; ++sample)
-        {
-            outputChannel[sample] = inputChannel[sample];
-        }
-    }
+TriggerManager* AudioProcessor::getTriggerManager(int lane) const
+{
+    auto* processingLane = getLane(lane);
+    return processingLane != nullptr ? processingLane->getTriggerManager() : nullptr;
+}
 
-    // Apply input gain
-    applyInputGain(outputBuffer);
+EffectProcessor* AudioProcessor::getEffectProcessor(int lane) const
+{
+    auto* processingLane = getLane(lane);
+    return processingLane != nullptr ? processingLane->getEffectProcessor() : nullptr;
+}
 
-    // Analyze audio for triggers
-    if (audioAnalyzer)
-    {
-        audioAnalyzer->processAudio(outputBuffer);
-        checkTriggers();
-    }
+AudioAnalyzer* AudioProcessor::getAudioAnalyzer(int lane) const
+{
+    auto* processingLane = getLane(lane);
+    return processingLane != nullptr ? processingLane->getAudioAnalyzer() : nullptr;
+}
+
+AnalysisThread* AudioProcessor::getAnalysisThread(int lane) const
+{
+    auto* processingLane = getLane(lane);
+    return processingLane != nullptr ? processingLane->getAnalysisThread() : nullptr;
+}
+
+void AudioProcessor::publishEffectList(int lane)
+{
+    auto* effectProcessor = getEffectProcessor(lane);
+    if (!effectProcessor)
+        return;
 
-    // Apply effects
-    if (effectProcessor)
+    // Effects an enabled trigger points at are switched in by it rather than always on
+    std::vector<int> switchedEffectIds;
+    for (const auto& trigger : getTriggers(lane))
     {
-        effectProcessor->processAudio(outputBuffer);
+        if (trigger.enabled)
+            switchedEffectIds.push_back(trigger.effectId);
     }
 
-    // Apply output gain
-    applyOutputGain(outputBuffer);
+    AudioCommand command;
+    command.type = AudioCommand::Type::SwapEffectList;
+    command.lane = lane;
+    command.payload = effectProcessor->createRenderList(switchedEffectIds);
+    postCommand(command);
+}
 
-    // Copy processed audio back to output
-    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+void AudioProcessor::postCommand(const AudioCommand& command)
+{
+    commandQueue.collectGarbage();
+
+    while (audioRunning.load(std::memory_order_acquire))
     {
-        const float* processedChannel = outputBuffer.getReadPointer(channel);
-        float* outputChannel = bufferToFill.buffer->getWritePointer(channel);
-        
-        for (int sample = 0; sample < bufferToFill.numSamples; ++sample)
-        {
-            outputChannel[sample] = processedChannel[sample];
-        }
+        if (commandQueue.push(command))
+            return;
+
+        // The callback drains the whole queue every block, so this won't wait long
+        juce::Thread::sleep(1);
+        commandQueue.collectGarbage();
     }
+
+    // No callback is running to drain the queue, so apply everything here, in order
+    processCommands();
+    applyCommand(command);
+    commandQueue.collectGarbage();
+}
+
+void AudioProcessor::processCommands()
+{
+    AudioCommand command;
+    while (commandQueue.pop(command))
+        applyCommand(command);
 }
 
-void AudioProcessor::applyInputGain(juce::AudioBuffer<float>& buffer)
+void AudioProcessor::applyCommand(const AudioCommand& command)
 {
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    auto& effectProcessor = *lanes[static_cast<size_t>(command.lane)]->getEffectProcessor();
+
+    switch (command.type)
     {
-        float* channelData = buffer.getWritePointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-        {
-            channelData[sample] *= inputGain;
-        }
+        case AudioCommand::Type::SwapEffectList:
+            commandQueue.retire(effectProcessor.exchangeRenderList(static_cast<EffectRenderList*>(command.payload)));
+            break;
+        case AudioCommand::Type::SetEffectEnabled:
+            effectProcessor.applyEffectEnabled(command.targetId, command.value != 0.0f);
+            break;
+        case AudioCommand::Type::SetEffectParameter:
+            effectProcessor.applyParameter(command.targetId, command.parameterId, command.value);
+            break;
     }
 }
 
-void AudioProcessor::applyOutputGain(juce::AudioBuffer<float>& buffer)
+void AudioProcessor::processAudio(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    // Everything below runs on the audio thread and must not touch the heap
+    RealtimeAllocationGuard::ScopedRealtimeSection realtimeSection;
+    profiler.beginBlock();
+
+    // Apply the message thread's edits before anything reads what they change
+    processCommands();
+    profiler.endStage(CallbackProfiler::Stage::Commands);
+
+    // Read the gains once so every lane and sub-block uses the same ones
+    const float blockInputGain = inputGain;
+    const float blockOutputGain = outputGain;
+
+    // Fetched once, since asking the buffer for write pointers also writes to it
+    float* const* deviceChannels = bufferToFill.buffer->getArrayOfWritePointers();
+
+    // Lanes share nothing, so they can run concurrently, each start to finish
+    // on whichever thread takes it. They're timed as one stage then, since the
+    // stage clock only follows one thread.
+    if (numActiveLanes > 1 && workerPool.getNumWorkers() > 0 && bufferToFill.numSamples >= minParallelLaneSamples)
     {
-        float* channelData = buffer.getWritePointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+        auto processLaneJob = [this, deviceChannels, &bufferToFill, blockInputGain, blockOutputGain](int index)
         {
-            channelData[sample] *= outputGain;
-        }
+            processLane(*lanes[static_cast<size_t>(index)], deviceChannels, bufferToFill, blockInputGain, blockOutputGain,
+                        nullptr);
+        };
+
+        workerPool.parallelFor(numActiveLanes, processLaneJob);
+        profiler.endStage(CallbackProfiler::Stage::Lanes);
     }
+    else
+    {
+        for (int i = 0; i < numActiveLanes; ++i)
+            processLane(*lanes[static_cast<size_t>(i)], deviceChannels, bufferToFill, blockInputGain, blockOutputGain,
+                        &profiler);
+    }
+
+    profiler.endBlock(bufferToFill.numSamples);
 }
 
-void AudioProcessor::checkTriggers()
+void AudioProcessor::processLane(ProcessingLane& lane, float* const* deviceChannels,
+                                 const juce::AudioSourceChannelInfo& bufferToFill,
+                                 float blockInputGain, float blockOutputGain, CallbackProfiler* stageProfiler)
 {
-    if (!triggerManager || !audioAnalyzer)
+    // Process the lane's device channels in place: wrap the region this
+    // callback owns (referencing, not copying, so nothing is allocated).
+    // Channels the device doesn't have are skipped.
+    const int numChannels = juce::jmin(lane.getNumChannels(), bufferToFill.buffer->getNumChannels() - lane.getFirstChannel());
+
+    if (numChannels <= 0)
         return;
 
-    // Get current detected note/chord/melody
-    float currentNote = audioAnalyzer->getCurrentNote();
-    float currentChord = audioAnalyzer->getCurrentChord();
-    float currentMelody = audioAnalyzer->getCurrentMelody();
+    // Every stage sized its scratch for blockSize, so longer callbacks are split
+    const int maxBlockSize = blockSize > 0 ? blockSize : bufferToFill.numSamples;
 
-    // Check for triggers
-    triggerManager->checkTriggers(currentNote, currentChord, currentMelody);
-} 
\ No newline at end of file
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += maxBlockSize)
+    {
+        const int numSamples = juce::jmin(maxBlockSize, bufferToFill.numSamples - offset);
+        juce::AudioBuffer<float> block(deviceChannels + lane.getFirstChannel(), numChannels,
+                                       bufferToFill.startSample + offset, numSamples);
+        lane.processBlock(block, blockInputGain, blockOutputGain, stageProfiler);
+    }
+}
@@ -2,12 +2,26 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_devices/juce_audio_devices.h>
+#include "AudioCommandQueue.h"
+#include "CallbackProfiler.h"
+#include "ProcessingLane.h"
+#include "Utils/RealtimeWorkerPool.h"
+#include <array>
+#include <atomic>
 #include <memory>
 #include <vector>
 
+struct Trigger;
 class TriggerManager;
 class EffectProcessor;
 class AudioAnalyzer;
+class AnalysisThread;
+
+enum class ChannelLayout
+{
+    Linked,   // One lane across every input channel, all of them analyzed and processed together
+    PerInput  // A lane per input channel, each with its own analysis, triggers and effects
+};
 
 class AudioProcessor : public juce::AudioSource
 {
@@ -26,26 +40,51 @@ public:
     float getInputGain() const { return inputGain; }
     float getOutputGain() const { return outputGain; }
 
-    // Trigger management
-    void addNoteTrigger(int note, int effectId);
-    void addChordTrigger(const std::vector<int>& notes, int effectId);
-    void addMelodyTrigger(const std::vector<int>& sequence, int effectId);
-    void removeTrigger(int triggerId);
+    // Channel layout (message thread; both take effect on the next prepareToPlay)
+    static constexpr int maxLanes = 8; // Inputs past the last lane pass through untouched
+    void setChannelLayout(ChannelLayout layout);
+    ChannelLayout getChannelLayout() const { return channelLayout; }
+    void setNumInputChannels(int numChannels);
+    int getNumInputChannels() const { return numInputChannels; }
+    int getNumLanes() const; // Lanes the layout uses for the current inputs
+    juce::String getLaneName(int lane) const;
+
+    // Spread lanes, and the channels of a lane's effects, across worker threads
+    // (on by default; takes effect on the next prepareToPlay)
+    void setParallelProcessing(bool shouldProcessInParallel);
+    bool getParallelProcessing() const { return parallelProcessing; }
+    int getNumWorkerThreads() const { return workerPool.getNumWorkers(); }
+
+    // Trigger management (message thread; TriggerManager compiles and publishes the set)
+    int addNoteTrigger(int note, int effectId, int lane = 0);
+    int addChordTrigger(const std::vector<int>& notes, int effectId, int lane = 0);
+    int addMelodyTrigger(const std::vector<int>& sequence, int effectId, int lane = 0); // Each returns the trigger id, or -1
+    void removeTrigger(int triggerId, int lane = 0);
+    const std::vector<Trigger>& getTriggers(int lane = 0) const;
 
-    // Effect management
-    void setEffectEnabled(int effectId, bool enabled);
-    void setEffectParameter(int effectId, int parameterId, float value);
-    bool isEffectEnabled(int effectId) const;
+    // Effect management (message thread; applied at the start of the next callback)
+    int addEffect(int effectType, int lane = 0);
+    void removeEffect(int effectId, int lane = 0);
+    void moveEffect(int effectId, int newIndex, int lane = 0);
+    void setEffectEnabled(int effectId, bool enabled, int lane = 0);
+    void setEffectParameter(int effectId, int parameterId, float value, int lane = 0);
+    bool isEffectEnabled(int effectId, int lane = 0) const;
 
     // Analysis
-    float getCurrentNote() const;
-    float getCurrentChord() const;
-    float getCurrentMelody() const;
+    float getCurrentNote(int lane = 0) const;
+    float getCurrentChord(int lane = 0) const;
+    float getCurrentMelody(int lane = 0) const;
+    int getCurrentChordId(int lane = 0) const; // -1 for none; see ChordDetector for the id scheme
+    void setAnalysisMode(AnalysisMode mode); // Takes effect on the next prepareToPlay
+    AnalysisMode getAnalysisMode() const { return analysisMode; }
 
-    // Access to components
-    TriggerManager* getTriggerManager() const { return triggerManager.get(); }
-    EffectProcessor* getEffectProcessor() const { return effectProcessor.get(); }
-    AudioAnalyzer* getAudioAnalyzer() const { return audioAnalyzer.get(); }
+    // Access to components (lanes outside 0..maxLanes-1 give nullptr)
+    ProcessingLane* getLane(int lane) const;
+    TriggerManager* getTriggerManager(int lane = 0) const;
+    EffectProcessor* getEffectProcessor(int lane = 0) const;
+    AudioAnalyzer* getAudioAnalyzer(int lane = 0) const;
+    AnalysisThread* getAnalysisThread(int lane = 0) const;
+    CallbackProfiler& getProfiler() { return profiler; }
 
 private:
     // Audio parameters
@@ -53,22 +92,38 @@ private:
     float outputGain = 1.0f;
     double sampleRate = 44100.0;
     int blockSize = 256;
+    AnalysisMode analysisMode = AnalysisMode::Synchronous;
+    ChannelLayout channelLayout = ChannelLayout::Linked;
+    int numInputChannels = 2;
+    bool parallelProcessing = true;
+
+    // Message thread -> audio thread edits
+    AudioCommandQueue commandQueue;
+    std::atomic<bool> audioRunning { false }; // Between prepareToPlay and releaseResources
+
+    // Workers the lanes share, sized at prepareToPlay for the jobs a callback
+    // can have (lanes, or channels of a linked lane) and the cores to run them
+    RealtimeWorkerPool workerPool;
+    static constexpr int minParallelLaneSamples = 64; // Shorter callbacks run the lanes one by one
+
+    // Lanes, all created up front so their triggers and effects can be set up
+    // before the layout uses them; the first numActiveLanes are prepared
+    std::array<std::unique_ptr<ProcessingLane>, maxLanes> lanes;
+    int numActiveLanes = 0;
 
-    // Processing components
-    std::unique_ptr<TriggerManager> triggerManager;
-    std::unique_ptr<EffectProcessor> effectProcessor;
-    std::unique_ptr<AudioAnalyzer> audioAnalyzer;
+    // Per-stage callback timing, off unless the diagnostics ask for it
+    CallbackProfiler profiler;
 
-    // Audio buffers
-    juce::AudioBuffer<float> inputBuffer;
-    juce::AudioBuffer<float> outputBuffer;
-    juce::AudioBuffer<float> tempBuffer;
+    // Command handling
+    void postCommand(const AudioCommand& command);
+    void processCommands();
+    void applyCommand(const AudioCommand& command);
+    void publishEffectList(int lane);
 
     // Processing methods
     void processAudio(const juce::AudioSourceChannelInfo& bufferToFill);
-    void applyInputGain(juce::AudioBuffer<float>& buffer);
-    void applyOutputGain(juce::AudioBuffer<float>& buffer);
-    void checkTriggers();
+    void processLane(ProcessingLane& lane, float* const* deviceChannels, const juce::AudioSourceChannelInfo& bufferToFill,
+                     float blockInputGain, float blockOutputGain, CallbackProfiler* stageProfiler);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioProcessor)
-}; 
\ No newline at end of file
+};
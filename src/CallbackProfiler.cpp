@@ -0,0 +1,263 @@
+#include "CallbackProfiler.h"
+#include <cmath>
+
+// Drains the ring every few milliseconds, well inside the time it takes the
+// callback to fill it even at 32-sample blocks and 192 kHz
+class CallbackProfiler::Collector : public juce::Thread
+{
+public:
+    explicit Collector(CallbackProfiler& owner)
+        : juce::Thread("Callback profiler"), profiler(owner)
+    {
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            profiler.drainRing();
+            wait(20);
+        }
+    }
+
+private:
+    CallbackProfiler& profiler;
+};
+
+CallbackProfiler::CallbackProfiler()
+{
+    records.resize(static_cast<size_t>(ringSize));
+    collector = std::make_unique<Collector>(*this);
+}
+
+CallbackProfiler::~CallbackProfiler()
+{
+    setEnabled(false);
+}
+
+void CallbackProfiler::prepareToPlay(int samplesPerBlockExpected, double newSampleRate)
+{
+    const juce::ScopedLock scope(statisticsLock);
+    sampleRate = newSampleRate;
+    blockSize = samplesPerBlockExpected;
+
+    // A restarted device isn't late
+    previousBlockStartTicks = 0;
+}
+
+void CallbackProfiler::releaseResources()
+{
+    previousBlockStartTicks = 0;
+    blockActive = false;
+}
+
+void CallbackProfiler::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == enabled.load(std::memory_order_relaxed))
+        return;
+
+    enabled.store(shouldBeEnabled, std::memory_order_relaxed);
+
+    if (shouldBeEnabled)
+    {
+        collector->startThread(juce::Thread::Priority::low);
+    }
+    else
+    {
+        collector->signalThreadShouldExit();
+        collector->notify();
+        collector->stopThread(1000);
+
+        // The collector is stopped, so this thread is the only reader now
+        drainRing();
+    }
+}
+
+void CallbackProfiler::reset()
+{
+    const juce::ScopedLock scope(statisticsLock);
+
+    for (auto& histogram : histograms)
+        histogram.clear();
+
+    numCallbacks = 0;
+    numOverruns = 0;
+    numLateCallbacks = 0;
+    droppedRecords.store(0, std::memory_order_relaxed);
+}
+
+CallbackProfiler::Report CallbackProfiler::getReport() const
+{
+    Report report;
+    const juce::ScopedLock scope(statisticsLock);
+
+    for (size_t i = 0; i < histograms.size(); ++i)
+    {
+        report.stages[i].p50Us = histograms[i].getPercentile(0.5);
+        report.stages[i].p99Us = histograms[i].getPercentile(0.99);
+        report.stages[i].maxUs = histograms[i].getMax();
+        report.stages[i].numRuns = histograms[i].getCount();
+    }
+
+    report.sampleRate = sampleRate;
+    report.blockSize = blockSize;
+    report.numCallbacks = numCallbacks;
+    report.numOverruns = numOverruns;
+    report.numLateCallbacks = numLateCallbacks;
+    report.numDroppedRecords = droppedRecords.load(std::memory_order_relaxed);
+    return report;
+}
+
+bool CallbackProfiler::writeReport(const juce::File& file, const juce::String& notes) const
+{
+    juce::String text;
+    text << "ToneTrigger callback profile, " << juce::Time::getCurrentTime().toString(true, true) << "\n";
+    if (notes.isNotEmpty())
+        text << notes << "\n";
+    text << "\n" << getReport().toText();
+
+    return file.getParentDirectory().createDirectory().wasOk() && file.replaceWithText(text);
+}
+
+juce::String CallbackProfiler::getStageName(int index)
+{
+    switch (index)
+    {
+        case static_cast<int>(Stage::Commands): return "Commands";
+        case static_cast<int>(Stage::Analysis): return "Analysis";
+        case static_cast<int>(Stage::Triggers): return "Triggers";
+        case static_cast<int>(Stage::Input): return "Input";
+        case static_cast<int>(Stage::Effects): return "Effects";
+        case static_cast<int>(Stage::Output): return "Output";
+        case static_cast<int>(Stage::Lanes): return "Lanes";
+        case totalIndex: return "Total";
+        default: return "Unknown";
+    }
+}
+
+juce::String CallbackProfiler::Report::toText() const
+{
+    juce::String text;
+    text << "Sample rate: " << juce::String(sampleRate, 0) << " Hz, block size: " << blockSize
+         << ", period: " << juce::String(getPeriodUs(), 1) << " us\n"
+         << "Callbacks: " << juce::String(numCallbacks)
+         << ", overruns: " << juce::String(numOverruns)
+         << ", late callbacks: " << juce::String(numLateCallbacks)
+         << ", dropped records: " << juce::String(numDroppedRecords) << "\n\n";
+
+    text << juce::String("Stage").paddedRight(' ', 10)
+         << juce::String("p50 us").paddedLeft(' ', 10) << juce::String("p99 us").paddedLeft(' ', 10)
+         << juce::String("max us").paddedLeft(' ', 10) << juce::String("p50 %").paddedLeft(' ', 9)
+         << juce::String("p99 %").paddedLeft(' ', 9) << juce::String("max %").paddedLeft(' ', 9)
+         << juce::String("runs").paddedLeft(' ', 10) << "\n";
+
+    for (int i = 0; i <= totalIndex; ++i)
+    {
+        const auto& stage = stages[static_cast<size_t>(i)];
+        text << getStageName(i).paddedRight(' ', 10)
+             << juce::String(stage.p50Us, 1).paddedLeft(' ', 10)
+             << juce::String(stage.p99Us, 1).paddedLeft(' ', 10)
+             << juce::String(stage.maxUs, 1).paddedLeft(' ', 10)
+             << juce::String(toPercentOfPeriod(stage.p50Us), 1).paddedLeft(' ', 9)
+             << juce::String(toPercentOfPeriod(stage.p99Us), 1).paddedLeft(' ', 9)
+             << juce::String(toPercentOfPeriod(stage.maxUs), 1).paddedLeft(' ', 9)
+             << juce::String(stage.numRuns).paddedLeft(' ', 10) << "\n";
+    }
+
+    return text;
+}
+
+void CallbackProfiler::pushRecord(const BlockRecord& record) noexcept
+{
+    int start1, size1, start2, size2;
+    ring.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 < 1)
+    {
+        droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    records[static_cast<size_t>(size1 > 0 ? start1 : start2)] = record;
+    ring.finishedWrite(1);
+}
+
+void CallbackProfiler::drainRing()
+{
+    const int numReady = ring.getNumReady();
+    if (numReady == 0)
+        return;
+
+    int start1, size1, start2, size2;
+    ring.prepareToRead(numReady, start1, size1, start2, size2);
+
+    {
+        const juce::ScopedLock scope(statisticsLock);
+
+        for (int i = 0; i < size1; ++i)
+            addRecord(records[static_cast<size_t>(start1 + i)]);
+        for (int i = 0; i < size2; ++i)
+            addRecord(records[static_cast<size_t>(start2 + i)]);
+    }
+
+    ring.finishedRead(size1 + size2);
+}
+
+void CallbackProfiler::addRecord(const BlockRecord& record)
+{
+    // Stages that were skipped this callback (no effects, no lanes) would
+    // otherwise pile zeros into the lower percentiles
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        if ((record.stagesRan & (1u << stage)) != 0)
+            histograms[static_cast<size_t>(stage)].add(static_cast<double>(record.stageTicks[static_cast<size_t>(stage)]) * ticksToUs);
+    }
+
+    const double totalUs = static_cast<double>(record.totalTicks) * ticksToUs;
+    histograms[static_cast<size_t>(totalIndex)].add(totalUs);
+    ++numCallbacks;
+
+    const double blockPeriodUs = 1.0e6 * record.numSamples / sampleRate;
+    if (totalUs > blockPeriodUs)
+        ++numOverruns;
+
+    if (record.intervalTicks > 0 && static_cast<double>(record.intervalTicks) * ticksToUs > 1.5 * blockPeriodUs)
+        ++numLateCallbacks;
+}
+
+void CallbackProfiler::Histogram::add(double us)
+{
+    const int bin = us <= minUs ? 0 : static_cast<int>(std::log(us / minUs) / std::log(binRatio)) + 1;
+    ++counts[static_cast<size_t>(juce::jmin(bin, numBins - 1))];
+    ++total;
+    maxUs = juce::jmax(maxUs, us);
+}
+
+void CallbackProfiler::Histogram::clear()
+{
+    counts.fill(0);
+    total = 0;
+    maxUs = 0.0;
+}
+
+double CallbackProfiler::Histogram::getPercentile(double fraction) const
+{
+    if (total == 0)
+        return 0.0;
+
+    // Report the geometric centre of the bin the percentile falls in
+    const auto rank = static_cast<juce::int64>(std::ceil(fraction * static_cast<double>(total)));
+    juce::int64 seen = 0;
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        seen += counts[static_cast<size_t>(bin)];
+        if (seen >= rank)
+        {
+            const double centreUs = bin == 0 ? minUs : minUs * std::pow(binRatio, bin - 0.5);
+            return juce::jmin(centreUs, maxUs);
+        }
+    }
+
+    return maxUs;
+}
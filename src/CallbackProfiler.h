@@ -0,0 +1,180 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Times the stages of the audio callback. The audio thread stamps each stage
+// with high-resolution ticks and pushes one record per block into a lock-free
+// single-producer/single-consumer ring; a low-priority collector thread drains
+// the ring into per-stage latency histograms and counts overruns (a callback
+// longer than its block period) and late callbacks (a gap between callbacks
+// of more than one and a half periods, which is usually the device dropping
+// out). Disabled, the audio thread pays one relaxed atomic load per block.
+class CallbackProfiler
+{
+public:
+    // Stages of AudioProcessor::processAudio, in callback order
+    enum class Stage
+    {
+        Commands,  // Applying queued edits
+        Analysis,  // Analyzer, or feeding the analysis thread
+        Triggers,  // Trigger matching and effect selection
+        Input,     // Input gain, when effects are about to run
+        Effects,   // Effect chain
+        Output,    // Output gain
+        Lanes      // Analysis to output for lanes running concurrently, timed as a whole
+    };
+
+    static constexpr int numStages = static_cast<int>(Stage::Lanes) + 1;
+    static constexpr int totalIndex = numStages; // Whole callback, after the stages in a Report
+    static juce::String getStageName(int index);
+
+    struct StageStatistics
+    {
+        double p50Us = 0.0;
+        double p99Us = 0.0;
+        double maxUs = 0.0;
+        juce::int64 numRuns = 0; // Callbacks the stage ran in
+    };
+
+    // Snapshot of everything collected since the last reset. Percentiles come
+    // from log-spaced histogram bins, so they're accurate to about 5%.
+    struct Report
+    {
+        std::array<StageStatistics, numStages + 1> stages;
+        double sampleRate = 0.0;
+        int blockSize = 0;
+        juce::int64 numCallbacks = 0;
+        juce::int64 numOverruns = 0;
+        juce::int64 numLateCallbacks = 0;
+        juce::int64 numDroppedRecords = 0;  // Ring was full; not counted in the statistics
+
+        double getPeriodUs() const { return sampleRate > 0.0 ? 1.0e6 * blockSize / sampleRate : 0.0; }
+        double toPercentOfPeriod(double us) const { return getPeriodUs() > 0.0 ? 100.0 * us / getPeriodUs() : 0.0; }
+        juce::String toText() const;
+    };
+
+    CallbackProfiler();
+    ~CallbackProfiler();
+
+    // Setup (call while the audio callback is stopped)
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    void releaseResources();
+
+    // Control (message thread)
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    void reset();
+
+    // Results (any thread but the audio thread)
+    Report getReport() const;
+    bool writeReport(const juce::File& file, const juce::String& notes = {}) const; // Notes go under the heading
+
+    // Audio thread: beginBlock, endStage after each stage that ran (stages
+    // that run more than once per callback add up), endBlock
+    void beginBlock() noexcept
+    {
+        if (!enabled.load(std::memory_order_relaxed))
+        {
+            blockActive = false;
+            previousBlockStartTicks = 0;
+            return;
+        }
+
+        blockActive = true;
+        current = {};
+        current.startTicks = juce::Time::getHighResolutionTicks();
+        current.intervalTicks = previousBlockStartTicks != 0 ? current.startTicks - previousBlockStartTicks : 0;
+        previousBlockStartTicks = current.startTicks;
+        lastMarkTicks = current.startTicks;
+    }
+
+    void endStage(Stage stage) noexcept
+    {
+        if (!blockActive)
+            return;
+
+        const auto now = juce::Time::getHighResolutionTicks();
+        current.stageTicks[static_cast<size_t>(stage)] += now - lastMarkTicks;
+        current.stagesRan |= 1u << static_cast<int>(stage);
+        lastMarkTicks = now;
+    }
+
+    void endBlock(int numSamples) noexcept
+    {
+        if (!blockActive)
+            return;
+
+        current.totalTicks = juce::Time::getHighResolutionTicks() - current.startTicks;
+        current.numSamples = numSamples;
+        pushRecord(current);
+        blockActive = false;
+    }
+
+private:
+    class Collector;
+
+    struct BlockRecord
+    {
+        juce::int64 startTicks = 0;
+        juce::int64 intervalTicks = 0;  // Since the previous block started, 0 if unknown
+        juce::int64 totalTicks = 0;
+        std::array<juce::int64, numStages> stageTicks {};
+        juce::uint32 stagesRan = 0;     // Bit per stage that ended this block
+        int numSamples = 0;
+    };
+
+    // Log-spaced bins from minUs up, each binRatio wider than the last
+    class Histogram
+    {
+    public:
+        void add(double us);
+        void clear();
+        double getPercentile(double fraction) const;
+        double getMax() const { return maxUs; }
+        juce::int64 getCount() const { return total; }
+
+    private:
+        static constexpr int numBins = 160;
+        static constexpr double minUs = 0.1;
+        static constexpr double binRatio = 1.1;
+
+        std::array<juce::int64, numBins> counts {};
+        juce::int64 total = 0;
+        double maxUs = 0.0;
+    };
+
+    // Audio thread -> collector
+    static constexpr int ringSize = 4096;
+    juce::AbstractFifo ring { ringSize };
+    std::vector<BlockRecord> records;
+    std::atomic<juce::int64> droppedRecords { 0 };
+    std::atomic<bool> enabled { false };
+
+    // Audio thread only
+    BlockRecord current;
+    bool blockActive = false;
+    juce::int64 previousBlockStartTicks = 0;
+    juce::int64 lastMarkTicks = 0;
+
+    // Collector state, guarded by statisticsLock
+    mutable juce::CriticalSection statisticsLock;
+    std::array<Histogram, numStages + 1> histograms;
+    juce::int64 numCallbacks = 0;
+    juce::int64 numOverruns = 0;
+    juce::int64 numLateCallbacks = 0;
+    double sampleRate = 44100.0;
+    int blockSize = 256;
+    double ticksToUs = 1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+
+    std::unique_ptr<Collector> collector;
+
+    void pushRecord(const BlockRecord& record) noexcept;
+    void drainRing();
+    void addRecord(const BlockRecord& record);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CallbackProfiler)
+};
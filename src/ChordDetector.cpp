@@ -1,11 +1,31 @@
 #include "ChordDetector.h"
+#include "AnalysisFrame.h"
 #include <cmath>
 #include <algorithm>
 #include <numeric>
 
+namespace
+{
+    constexpr int numPitchClasses = 12;
+
+    // Partials that land on a different pitch class than their fundamental
+    // (octaves fold onto the root and need no special treatment)
+    bool isNonOctaveHarmonic(float frequency, float fundamental)
+    {
+        const float ratio = frequency / fundamental;
+        const int harmonic = static_cast<int>(std::round(ratio));
+
+        if (harmonic != 3 && harmonic != 5 && harmonic != 6 && harmonic != 7)
+            return false;
+
+        return std::abs(ratio - harmonic) < 0.03f * harmonic;
+    }
+}
+
 ChordDetector::ChordDetector()
 {
     initializeChordDatabase();
+    compileChordTemplates();
 }
 
 ChordDetector::~ChordDetector()
@@ -15,6 +35,14 @@ ChordDetector::~ChordDetector()
 void ChordDetector::prepareToPlay(double newSampleRate)
 {
     sampleRate = newSampleRate;
+
+    // Audio is stopped, so pending database edits can be compiled in place
+    const juce::ScopedLock lock(databaseLock);
+    if (templatesOutOfDate)
+    {
+        compileChordTemplates();
+        templatesOutOfDate = false;
+    }
 }
 
 void ChordDetector::releaseResources()
@@ -27,21 +55,202 @@ void ChordDetector::releaseResources()
 ChordInfo ChordDetector::detectChord(const std::vector<float>& frequencies, const std::vector<float>& magnitudes)
 {
     analyzeHarmonics(frequencies, magnitudes);
-    auto notes = extractNotes(frequencies, magnitudes);
+    return detectChordFromHarmonics();
+}
+
+ChordInfo ChordDetector::detectChord(const AnalysisFrame& frame)
+{
+    // The frame already carries interpolated spectral peaks, strongest first,
+    // so skip our own peak picking
+    harmonicFrequencies.assign(frame.peakFrequencies.begin(), frame.peakFrequencies.end());
+    harmonicMagnitudes.assign(frame.peakMagnitudes.begin(), frame.peakMagnitudes.end());
+    
+    // Normalise against the strongest peak so detectionThreshold is a
+    // relative level and doesn't depend on the input gain
+    if (!harmonicMagnitudes.empty() && harmonicMagnitudes[0] > 0.0f)
+    {
+        const float scale = 1.0f / harmonicMagnitudes[0];
+        for (auto& magnitude : harmonicMagnitudes)
+            magnitude *= scale;
+    }
+    
+    return detectChordFromHarmonics();
+}
+
+int ChordDetector::detectChordId(const AnalysisFrame& frame)
+{
+    lastChordScore = 0.0f;
+    chordScoresValid = false;
+    computeChroma(frame);
+
+    // Need at least two pitch classes before calling anything a chord
+    const int mask = getChromaMask();
+    if (juce::countNumberOfBits(static_cast<juce::uint32>(mask)) < 2 || getNumChordIds() == 0)
+        return -1;
+
+    int chordId = -1;
+    if (matchMethod == ChordMatchMethod::MaskLookup)
+    {
+        chordId = maskChordIds[mask];
+        lastChordScore = maskChordScores[mask];
+    }
+    else
+    {
+        chordId = scoreChromaAgainstTemplates();
+    }
+
+    if (chordId < 0 || lastChordScore < confidenceThreshold)
+        return -1;
+
+    return chordId;
+}
+
+int ChordDetector::scoreChromaAgainstTemplates()
+{
+    const int numChordIds = getNumChordIds();
+
+    // scores = templateMatrix * chroma, one column at a time
+    juce::FloatVectorOperations::clear(chordScores.data(), numChordIds);
+    for (int pitchClass = 0; pitchClass < numPitchClasses; ++pitchClass)
+    {
+        if (chroma[pitchClass] > 0.0f)
+            juce::FloatVectorOperations::addWithMultiply(chordScores.data(),
+                                                         templateMatrix.data() + pitchClass * numChordIds,
+                                                         chroma[pitchClass], numChordIds);
+    }
+
+    // Both sides are unit length, so each score is a cosine similarity
+    const auto best = std::max_element(chordScores.begin(), chordScores.begin() + numChordIds);
+    lastChordScore = *best;
+    chordScoresValid = true;
+
+    return static_cast<int>(best - chordScores.begin());
+}
+
+int ChordDetector::getChromaMask() const
+{
+    // Pitch classes at least detectionThreshold of the strongest one
+    const float presenceLevel = detectionThreshold * *std::max_element(chroma.begin(), chroma.end());
+
+    int mask = 0;
+    for (int pitchClass = 0; pitchClass < numPitchClasses; ++pitchClass)
+    {
+        if (chroma[pitchClass] > 0.0f && chroma[pitchClass] >= presenceLevel)
+            mask |= 1 << pitchClass;
+    }
+
+    return mask;
+}
+
+void ChordDetector::computeChroma(const AnalysisFrame& frame)
+{
+    chroma.fill(0.0f);
+
+    const int numPeaks = static_cast<int>(frame.peakFrequencies.size());
+    if (numPeaks == 0 || frame.peakMagnitudes[0] <= 0.0f)
+        return;
+
+    const float scale = 1.0f / frame.peakMagnitudes[0];
+
+    for (int i = 0; i < numPeaks; ++i)
+    {
+        const float frequency = frame.peakFrequencies[i];
+        float weight = frame.peakMagnitudes[i] * scale;
+
+        if (weight < detectionThreshold || frequency <= 0.0f)
+            continue;
+
+        // Peaks are strongest first, so a 3rd/5th/6th/7th partial of an
+        // earlier peak is most likely overtone rather than a played note
+        for (int j = 0; j < i; ++j)
+        {
+            if (isNonOctaveHarmonic(frequency, frame.peakFrequencies[j]))
+            {
+                weight *= harmonicWeight;
+                break;
+            }
+        }
+
+        const int pitchClass = ((noteToMidi(frequencyToNote(frequency)) % numPitchClasses) + numPitchClasses) % numPitchClasses;
+        chroma[pitchClass] += weight;
+    }
+
+    float norm = 0.0f;
+    for (float value : chroma)
+        norm += value * value;
+
+    if (norm <= 0.0f)
+        return;
+
+    const float unitScale = 1.0f / std::sqrt(norm);
+    for (auto& value : chroma)
+        value *= unitScale;
+}
+
+const std::string& ChordDetector::getChordTypeName(int chordId) const
+{
+    static const std::string none("None");
+
+    if (chordId < 0 || chordId >= getNumChordIds())
+        return none;
+
+    return chordTemplates[chordId / numPitchClasses].name;
+}
+
+int ChordDetector::getChordPitchClassMask(int chordId) const
+{
+    if (chordId < 0 || chordId >= getNumChordIds())
+        return 0;
+
+    // Templates are root-relative; rotate up to the chord's root
+    const int relativeMask = chordTemplates[chordId / numPitchClasses].pitchClassMask;
+    const int root = chordId % numPitchClasses;
+    return ((relativeMask << root) | (relativeMask >> (numPitchClasses - root))) & (numPitchClassMasks - 1);
+}
+
+int ChordDetector::findChordForMask(int pitchClassMask) const
+{
+    if (pitchClassMask <= 0 || pitchClassMask >= static_cast<int>(maskChordIds.size()))
+        return -1;
+
+    return maskChordIds[pitchClassMask];
+}
+
+float ChordDetector::getMaskMatchScore(int pitchClassMask) const
+{
+    if (pitchClassMask <= 0 || pitchClassMask >= static_cast<int>(maskChordScores.size()))
+        return 0.0f;
+
+    return maskChordScores[pitchClassMask];
+}
+
+ChordInfo ChordDetector::getChordInfo(int chordId, float confidence) const
+{
+    if (chordId < 0 || chordId >= getNumChordIds())
+        return ChordInfo("None", {}, 0.0f, -1);
+
+    const auto& chordTemplate = chordTemplates[chordId / numPitchClasses];
+    return ChordInfo(chordTemplate.name, chordTemplate.intervals, confidence, chordId % numPitchClasses);
+}
+
+ChordInfo ChordDetector::detectChordFromHarmonics()
+{
+    auto notes = extractNotes(harmonicFrequencies, harmonicMagnitudes);
     
     if (notes.empty())
         return ChordInfo("None", {}, 0.0f, -1);
     
-    std::vector<ChordInfo> allChords = detectAllChords(frequencies, magnitudes);
+    int mask = 0;
+    for (int note : notes)
+        mask |= 1 << note;
     
-    if (allChords.empty())
-        return ChordInfo("Unknown", {}, 0.0f, notes[0]);
+    const int chordId = findChordForMask(mask);
+    const float score = getMaskMatchScore(mask);
     
-    // Return the chord with highest confidence
-    auto bestChord = std::max_element(allChords.begin(), allChords.end(),
-        [](const ChordInfo& a, const ChordInfo& b) { return a.confidence < b.confidence; });
+    if (chordId < 0 || score < confidenceThreshold)
+        return ChordInfo("Unknown", {}, 0.0f, notes[0]);
     
-    return *bestChord;
+    return getChordInfo(chordId, score);
 }
 
 std::vector<ChordInfo> ChordDetector::detectAllChords(const std::vector<float>& frequencies, const std::vector<float>& magnitudes)
@@ -55,31 +264,32 @@ std::vector<ChordInfo> ChordDetector::detectAllChords(const std::vector<float>&
     // Sort notes
     std::sort(notes.begin(), notes.end());
     
-    // Try each note as root
+    int noteMask = 0;
+    for (int note : notes)
+        noteMask |= 1 << note;
+    
+    // Try each note as root, comparing root-relative pitch class sets
+    // against the compiled templates
     for (int rootNote : notes)
     {
-        // Transpose notes to start from root
-        std::vector<int> transposedNotes;
-        for (int note : notes)
+        const int rotatedMask = ((noteMask >> rootNote) | (noteMask << (12 - rootNote))) & 0xfff;
+        
+        // Score against intervals from this root, not from the lowest note
+        std::vector<int> rootIntervals;
+        for (int interval = 0; interval < 12; ++interval)
         {
-            int transposed = (note - rootNote + 12) % 12;
-            if (transposed != 0) // Don't add root twice
-                transposedNotes.push_back(transposed);
+            if ((rotatedMask & (1 << interval)) != 0)
+                rootIntervals.push_back(interval);
         }
-        transposedNotes.push_back(0); // Add root
-        
-        // Get intervals
-        auto intervals = getNoteIntervals(transposedNotes);
         
-        // Check against chord database
-        for (const auto& chord : chordDatabase)
+        for (const auto& chord : chordTemplates)
         {
-            if (intervalsMatch(intervals, chord.second))
+            if (chord.pitchClassMask == rotatedMask)
             {
-                float confidence = calculateChordConfidence(notes, chord.second);
+                float confidence = calculateChordConfidence(rootIntervals, chord.intervals);
                 if (confidence >= confidenceThreshold)
                 {
-                    detectedChords.emplace_back(chord.first, chord.second, confidence, rootNote);
+                    detectedChords.emplace_back(chord.name, chord.intervals, confidence, rootNote);
                 }
             }
         }
@@ -143,7 +353,7 @@ float ChordDetector::calculateChordConfidence(const std::vector<int>& detectedNo
     
     for (int interval : chordIntervals)
     {
-        if (std::find(detectedNotes.begin(), detectedNotes.end(), interval) != detectedNotes.end())
+        if (std::find(detectedNotes.begin(), detectedNotes.end(), interval % 12) != detectedNotes.end())
         {
             matches++;
         }
@@ -159,20 +369,25 @@ float ChordDetector::calculateChordConfidence(const std::vector<int>& detectedNo
 
 void ChordDetector::addCustomChord(const std::string& name, const std::vector<int>& intervals)
 {
+    const juce::ScopedLock lock(databaseLock);
     chordDatabase[name] = intervals;
+    templatesOutOfDate = true;
 }
 
 void ChordDetector::removeCustomChord(const std::string& name)
 {
+    const juce::ScopedLock lock(databaseLock);
     chordDatabase.erase(name);
+    extendedChordDatabase.erase(name);
+    templatesOutOfDate = true;
 }
 
 std::vector<std::string> ChordDetector::getAvailableChords() const
 {
     std::vector<std::string> chords;
-    for (const auto& chord : chordDatabase)
+    for (const auto& chord : chordTemplates)
     {
-        chords.push_back(chord.first);
+        chords.push_back(chord.name);
     }
     return chords;
 }
@@ -194,7 +409,9 @@ void ChordDetector::setConfidenceThreshold(float threshold)
 
 void ChordDetector::enableExtendedChords(bool enabled)
 {
+    const juce::ScopedLock lock(databaseLock);
     extendedChordsEnabled = enabled;
+    templatesOutOfDate = true;
 }
 
 void ChordDetector::initializeChordDatabase()
@@ -234,17 +451,114 @@ void ChordDetector::initializeChordDatabase()
     // Power chords
     chordDatabase["5"] = {0, 7};
     
-    // Extended chords (if enabled)
+    // Extended chords (compiled in while enabled)
+    extendedChordDatabase["maj7#11"] = {0, 4, 7, 11, 18};
+    extendedChordDatabase["min7b5"] = {0, 3, 6, 10};
+    extendedChordDatabase["7#5"] = {0, 4, 8, 10};
+    extendedChordDatabase["7b5"] = {0, 4, 6, 10};
+    extendedChordDatabase["7#9"] = {0, 4, 7, 10, 15};
+    extendedChordDatabase["7b9"] = {0, 4, 7, 10, 13};
+    extendedChordDatabase["7#11"] = {0, 4, 7, 10, 18};
+    extendedChordDatabase["7b13"] = {0, 4, 7, 10, 20};
+}
+
+void ChordDetector::compileChordTemplates()
+{
+    // Not real-time safe: call from the message thread while analysis is idle
+    chordTemplates.clear();
+
+    auto addTemplates = [this](const std::map<std::string, std::vector<int>>& database)
+    {
+        for (const auto& chord : database)
+        {
+            ChordTemplate chordTemplate;
+            chordTemplate.name = chord.first;
+            chordTemplate.intervals = chord.second;
+
+            for (int interval : getNoteIntervals(chord.second))
+                chordTemplate.pitchClassMask |= 1 << interval;
+
+            if (chordTemplate.pitchClassMask != 0)
+                chordTemplates.push_back(std::move(chordTemplate));
+        }
+    };
+
+    addTemplates(chordDatabase);
     if (extendedChordsEnabled)
+        addTemplates(extendedChordDatabase);
+
+    // Simpler chords first so they win ties against supersets with the same score
+    std::stable_sort(chordTemplates.begin(), chordTemplates.end(),
+        [](const ChordTemplate& a, const ChordTemplate& b)
+        {
+            return juce::countNumberOfBits(static_cast<juce::uint32>(a.pitchClassMask))
+                 < juce::countNumberOfBits(static_cast<juce::uint32>(b.pitchClassMask));
+        });
+
+    const int numChordIds = getNumChordIds();
+    chordScoresValid = false;
+    templateMatrix.assign(numPitchClasses * numChordIds, 0.0f);
+    chordScores.assign(numChordIds, 0.0f);
+
+    for (int type = 0; type < static_cast<int>(chordTemplates.size()); ++type)
+    {
+        const int mask = chordTemplates[type].pitchClassMask;
+        const float weight = 1.0f / std::sqrt(static_cast<float>(juce::countNumberOfBits(static_cast<juce::uint32>(mask))));
+
+        for (int root = 0; root < numPitchClasses; ++root)
+        {
+            const int chordId = type * numPitchClasses + root;
+
+            for (int interval = 0; interval < numPitchClasses; ++interval)
+            {
+                if ((mask & (1 << interval)) != 0)
+                    templateMatrix[((root + interval) % numPitchClasses) * numChordIds + chordId] = weight;
+            }
+        }
+    }
+
+    buildMaskLookup();
+}
+
+void ChordDetector::buildMaskLookup()
+{
+    // Same cosine score as the template matrix, on binary vectors:
+    // |mask & chord| / sqrt(|mask| * |chord|). Ties go to the earlier,
+    // simpler template.
+    const int numChordIds = getNumChordIds();
+
+    std::vector<int> chordMasks(numChordIds);
+    for (int chordId = 0; chordId < numChordIds; ++chordId)
     {
-        chordDatabase["maj7#11"] = {0, 4, 7, 11, 18};
-        chordDatabase["min7b5"] = {0, 3, 6, 10};
-        chordDatabase["7#5"] = {0, 4, 8, 10};
-        chordDatabase["7b5"] = {0, 4, 6, 10};
-        chordDatabase["7#9"] = {0, 4, 7, 10, 15};
-        chordDatabase["7b9"] = {0, 4, 7, 10, 13};
-        chordDatabase["7#11"] = {0, 4, 7, 10, 18};
-        chordDatabase["7b13"] = {0, 4, 7, 10, 20};
+        const int mask = chordTemplates[chordId / numPitchClasses].pitchClassMask;
+        const int root = chordId % numPitchClasses;
+        chordMasks[chordId] = ((mask << root) | (mask >> (numPitchClasses - root))) & (numPitchClassMasks - 1);
+    }
+
+    maskChordIds.assign(numPitchClassMasks, -1);
+    maskChordScores.assign(numPitchClassMasks, 0.0f);
+
+    for (int mask = 1; mask < numPitchClassMasks; ++mask)
+    {
+        const int numNotes = juce::countNumberOfBits(static_cast<juce::uint32>(mask));
+        if (numNotes < 2)
+            continue;
+
+        for (int chordId = 0; chordId < numChordIds; ++chordId)
+        {
+            const int common = juce::countNumberOfBits(static_cast<juce::uint32>(mask & chordMasks[chordId]));
+            if (common == 0)
+                continue;
+
+            const int numChordNotes = juce::countNumberOfBits(static_cast<juce::uint32>(chordMasks[chordId]));
+            const float score = common / std::sqrt(static_cast<float>(numNotes * numChordNotes));
+
+            if (score > maskChordScores[mask])
+            {
+                maskChordScores[mask] = score;
+                maskChordIds[mask] = chordId;
+            }
+        }
     }
 }
 
@@ -268,15 +582,19 @@ float ChordDetector::midiToFrequency(int midiNote)
 
 std::vector<int> ChordDetector::getNoteIntervals(const std::vector<int>& notes)
 {
-    if (notes.size() < 2)
+    // Sorted, de-duplicated pitch classes relative to the first note
+    if (notes.empty())
         return {};
     
     std::vector<int> intervals;
-    for (size_t i = 1; i < notes.size(); ++i)
+    for (int note : notes)
     {
-        intervals.push_back((notes[i] - notes[0] + 12) % 12);
+        intervals.push_back(((note - notes[0]) % 12 + 12) % 12);
     }
     
+    std::sort(intervals.begin(), intervals.end());
+    intervals.erase(std::unique(intervals.begin(), intervals.end()), intervals.end());
+    
     return intervals;
 }
 
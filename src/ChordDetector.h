@@ -1,10 +1,19 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
 #include <vector>
 #include <string>
 #include <map>
 
+struct AnalysisFrame;
+
+enum class ChordMatchMethod
+{
+    TemplateScore,  // Weighted chroma against the template matrix
+    MaskLookup      // Thresholded chroma mask through the precomputed table
+};
+
 struct ChordInfo
 {
     std::string name;
@@ -29,6 +38,8 @@ public:
 
     // Chord detection
     ChordInfo detectChord(const std::vector<float>& frequencies, const std::vector<float>& magnitudes);
+    ChordInfo detectChord(const AnalysisFrame& frame);
+    int detectChordId(const AnalysisFrame& frame); // Allocation free, -1 if no chord
     std::vector<ChordInfo> detectAllChords(const std::vector<float>& frequencies, const std::vector<float>& magnitudes);
     
     // Analysis
@@ -36,16 +47,36 @@ public:
     std::vector<int> extractNotes(const std::vector<float>& frequencies, const std::vector<float>& magnitudes);
     float calculateChordConfidence(const std::vector<int>& detectedNotes, const std::vector<int>& chordIntervals);
 
-    // Chord database
+    // Chroma analysis
+    const std::array<float, 12>& getChroma() const { return chroma; }
+    float getLastChordScore() const { return lastChordScore; }
+    const float* getChordScores() const { return chordScoresValid ? chordScores.data() : nullptr; } // Per chord id, last frame
+
+    // Chord ids: id = chord type * 12 + root pitch class
+    int getNumChordIds() const { return static_cast<int>(chordTemplates.size()) * 12; }
+    int getChordRoot(int chordId) const { return chordId >= 0 ? chordId % 12 : -1; }
+    const std::string& getChordTypeName(int chordId) const;
+    int getChordPitchClassMask(int chordId) const; // Absolute pitch classes of the chord, 0 for none
+    ChordInfo getChordInfo(int chordId, float confidence) const;
+
+    // Pitch-class mask lookup (bit n = pitch class n present)
+    int findChordForMask(int pitchClassMask) const;
+    float getMaskMatchScore(int pitchClassMask) const;
+
+    // Chord database. Edits are held until the next prepareToPlay, where the
+    // templates are recompiled with audio stopped; the analysis reads them
+    // without locking.
     void addCustomChord(const std::string& name, const std::vector<int>& intervals);
     void removeCustomChord(const std::string& name);
-    std::vector<std::string> getAvailableChords() const;
+    std::vector<std::string> getAvailableChords() const; // Compiled vocabulary
 
     // Settings
     void setDetectionThreshold(float threshold);
     void setHarmonicWeight(float weight);
     void setConfidenceThreshold(float threshold);
-    void enableExtendedChords(bool enabled);
+    void enableExtendedChords(bool enabled); // From the next prepareToPlay
+    void setChordMatchMethod(ChordMatchMethod method) { matchMethod = method; }
+    ChordMatchMethod getChordMatchMethod() const { return matchMethod; }
 
 private:
     // Analysis parameters
@@ -54,6 +85,7 @@ private:
     float harmonicWeight = 0.3f;
     float confidenceThreshold = 0.5f;
     bool extendedChordsEnabled = true;
+    ChordMatchMethod matchMethod = ChordMatchMethod::TemplateScore;
 
     // Harmonic analysis
     std::vector<float> harmonicFrequencies;
@@ -62,11 +94,40 @@ private:
 
     // Chord database
     std::map<std::string, std::vector<int>> chordDatabase;
+    std::map<std::string, std::vector<int>> extendedChordDatabase;
+    juce::CriticalSection databaseLock;   // Edits vs. compiling in prepareToPlay
+    bool templatesOutOfDate = false;      // Database edited since the last compile
+    
+    // Compiled chord templates: one row per (type, root), stored column-major
+    // so each chroma bin scales one contiguous column into the scores
+    struct ChordTemplate
+    {
+        std::string name;
+        std::vector<int> intervals;
+        int pitchClassMask = 0; // Bit n set if the chord contains root + n semitones
+    };
+    std::vector<ChordTemplate> chordTemplates;
+    std::vector<float> templateMatrix;
+    std::vector<float> chordScores;
+    std::array<float, 12> chroma {};
+    float lastChordScore = 0.0f;
+    bool chordScoresValid = false;
+    
+    // Best chord id and its score for every possible pitch-class mask
+    static constexpr int numPitchClassMasks = 1 << 12;
+    std::vector<int> maskChordIds;
+    std::vector<float> maskChordScores;
     
     // Predefined chords
     void initializeChordDatabase();
+    void compileChordTemplates();
+    void buildMaskLookup();
+    int scoreChromaAgainstTemplates();
+    int getChromaMask() const;
+    void computeChroma(const AnalysisFrame& frame);
     
     // Helper methods
+    ChordInfo detectChordFromHarmonics();
     float frequencyToNote(float frequency);
     int noteToMidi(float note);
     float midiToFrequency(int midiNote);
@@ -0,0 +1,158 @@
+#include "ChordTracker.h"
+#include <cmath>
+#include <algorithm>
+
+ChordTracker::ChordTracker()
+{
+    updateTransitionCosts();
+}
+
+ChordTracker::~ChordTracker()
+{
+}
+
+void ChordTracker::prepare(int newNumChordIds, int newMaxLag)
+{
+    numChordIds = juce::jmax(0, newNumChordIds);
+    numStates = numChordIds + 1;
+    maxLag = juce::jmax(0, newMaxLag);
+    lag = juce::jmin(lag, maxLag);
+
+    emissions.assign(numStates, 0.0f);
+    pathScores.assign(numStates, 0.0f);
+    nextPathScores.assign(numStates, 0.0f);
+    backPointers.assign((maxLag + 1) * numStates, 0);
+
+    updateTransitionCosts();
+    reset();
+}
+
+void ChordTracker::reset()
+{
+    std::fill(pathScores.begin(), pathScores.end(), 0.0f);
+    currentRow = 0;
+    framesProcessed = 0;
+}
+
+int ChordTracker::processFrame(const float* chordScores)
+{
+    if (numStates == 0)
+        return -1;
+
+    const float noChordEmission = emissionSharpness * (noChordScore - 1.0f);
+
+    if (chordScores == nullptr)
+    {
+        std::fill(emissions.begin(), emissions.begin() + numChordIds, -emissionSharpness);
+    }
+    else
+    {
+        for (int state = 0; state < numChordIds; ++state)
+            emissions[state] = emissionSharpness * (chordScores[state] - 1.0f);
+    }
+    emissions[numChordIds] = noChordEmission;
+
+    return advance();
+}
+
+int ChordTracker::processFrame(int chordId, float score)
+{
+    if (numStates == 0)
+        return -1;
+
+    std::fill(emissions.begin(), emissions.begin() + numChordIds, -emissionSharpness);
+    if (chordId >= 0 && chordId < numChordIds)
+        emissions[chordId] = emissionSharpness * (score - 1.0f);
+    emissions[numChordIds] = emissionSharpness * (noChordScore - 1.0f);
+
+    return advance();
+}
+
+void ChordTracker::setLag(int frames)
+{
+    lag = juce::jlimit(0, maxLag, frames);
+}
+
+void ChordTracker::setSelfTransitionProbability(float probability)
+{
+    selfTransitionProbability = juce::jlimit(0.5f, 0.9999f, probability);
+    updateTransitionCosts();
+}
+
+void ChordTracker::setNoChordScore(float score)
+{
+    noChordScore = juce::jlimit(0.0f, 1.0f, score);
+}
+
+void ChordTracker::setEmissionSharpness(float sharpness)
+{
+    emissionSharpness = juce::jlimit(1.0f, 100.0f, sharpness);
+}
+
+int ChordTracker::advance()
+{
+    int* row = backPointers.data() + currentRow * numStates;
+
+    if (framesProcessed == 0)
+    {
+        for (int state = 0; state < numStates; ++state)
+        {
+            pathScores[state] = emissions[state];
+            row[state] = state;
+        }
+    }
+    else
+    {
+        // With a uniform switching probability every state's best predecessor
+        // is either itself or the overall best, so a step costs O(states)
+        const auto best = std::max_element(pathScores.begin(), pathScores.end());
+        const int bestState = static_cast<int>(best - pathScores.begin());
+        const float switchScore = *best + logSwitch;
+
+        for (int state = 0; state < numStates; ++state)
+        {
+            const float stayScore = pathScores[state] + logStay;
+
+            if (stayScore >= switchScore || state == bestState)
+            {
+                nextPathScores[state] = stayScore + emissions[state];
+                row[state] = state;
+            }
+            else
+            {
+                nextPathScores[state] = switchScore + emissions[state];
+                row[state] = bestState;
+            }
+        }
+
+        std::swap(pathScores, nextPathScores);
+    }
+
+    // Keep the scores near zero so they never lose precision
+    const float maxScore = *std::max_element(pathScores.begin(), pathScores.end());
+    for (auto& score : pathScores)
+        score -= maxScore;
+
+    ++framesProcessed;
+
+    // Trace the best path back lag frames (fewer right after a reset)
+    int state = static_cast<int>(std::max_element(pathScores.begin(), pathScores.end()) - pathScores.begin());
+    const int steps = juce::jmin(lag, framesProcessed - 1);
+    int traceRow = currentRow;
+
+    for (int step = 0; step < steps; ++step)
+    {
+        state = backPointers[traceRow * numStates + state];
+        traceRow = traceRow == 0 ? maxLag : traceRow - 1;
+    }
+
+    currentRow = currentRow == maxLag ? 0 : currentRow + 1;
+
+    return stateToChordId(state);
+}
+
+void ChordTracker::updateTransitionCosts()
+{
+    logStay = std::log(selfTransitionProbability);
+    logSwitch = std::log((1.0f - selfTransitionProbability) / juce::jmax(1, numStates - 1));
+}
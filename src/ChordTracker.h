@@ -0,0 +1,58 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// Online chord smoothing: an HMM over the chord vocabulary plus a "no chord"
+// state, decoded with fixed-lag Viterbi. Each frame advances the trellis by
+// one step and returns the best path's state from `lag` frames ago, so the
+// decision latency is exactly lag analysis hops.
+class ChordTracker
+{
+public:
+    ChordTracker();
+    ~ChordTracker();
+
+    // Setup - allocates the trellis for numChordIds states and up to maxLag frames
+    void prepare(int numChordIds, int maxLag);
+    void reset();
+    int getNumChordIds() const { return numChordIds; }
+
+    // Decoding (real-time safe once prepared); both return a chord id, -1 for none
+    int processFrame(const float* chordScores);    // One score in [0, 1] per chord id, nullptr if no candidates
+    int processFrame(int chordId, float score);    // Single detection, e.g. from a mask lookup
+
+    // Settings
+    void setLag(int frames);
+    int getLag() const { return lag; }
+    void setSelfTransitionProbability(float probability);
+    void setNoChordScore(float score);
+    void setEmissionSharpness(float sharpness);
+
+private:
+    // Model parameters
+    int numChordIds = 0;
+    int numStates = 0;                 // numChordIds + 1, the last being "no chord"
+    int maxLag = 0;
+    int lag = 4;
+    float selfTransitionProbability = 0.95f;
+    float noChordScore = 0.5f;         // Score the "no chord" state earns every frame
+    float emissionSharpness = 20.0f;   // Log-likelihood per unit of score
+    float logStay = 0.0f;
+    float logSwitch = 0.0f;
+
+    // Trellis
+    std::vector<float> emissions;
+    std::vector<float> pathScores;
+    std::vector<float> nextPathScores;
+    std::vector<int> backPointers;     // Ring of (maxLag + 1) rows of numStates
+    int currentRow = 0;
+    int framesProcessed = 0;
+
+    // Helper methods
+    int advance();
+    void updateTransitionCosts();
+    int stateToChordId(int state) const { return state < numChordIds ? state : -1; }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChordTracker)
+};
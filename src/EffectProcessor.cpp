@@ -5,26 +5,52 @@
 #include "Effects/ChorusEffect.h"
 #include "Effects/FilterEffect.h"
 #include "Effects/CompressorEffect.h"
+#include <algorithm>
+
+EffectRenderList::EffectRenderList()
+{
+}
+
+EffectRenderList::~EffectRenderList()
+{
+}
+
+void EffectRenderList::updateChain()
+{
+    chain.clear();
+    for (const auto& entry : entries)
+    {
+        if (entry.enabled && !entry.switched && entry.effect)
+            chain.push_back(entry.effect);
+    }
+}
 
 EffectProcessor::EffectProcessor()
 {
+    renderList = new EffectRenderList();
+    publishedRenderList = renderList;
 }
 
 EffectProcessor::~EffectProcessor()
 {
+    // Lists still in flight belong to whoever holds the command; this one is ours
+    delete renderList;
 }
 
-void EffectProcessor::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void EffectProcessor::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels)
 {
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
+    this->numChannels = numChannels;
 
     // Prepare all effects
     for (auto& effectInstance : effects)
     {
         if (effectInstance.effect)
-            effectInstance.effect->prepareToPlay(samplesPerBlockExpected, sampleRate);
+            effectInstance.effect->prepareToPlay(samplesPerBlockExpected, sampleRate, numChannels);
     }
+    switcher.prepareToPlay(samplesPerBlockExpected, sampleRate, numChannels);
+    updateSwitchedEffect();
 }
 
 void EffectProcessor::releaseResources()
@@ -34,6 +60,8 @@ void EffectProcessor::releaseResources()
         if (effectInstance.effect)
             effectInstance.effect->releaseResources();
     }
+    switcher.releaseResources();
+    activeEffectId = -1;
 }
 
 int EffectProcessor::addEffect(EffectType type)
@@ -41,14 +69,12 @@ int EffectProcessor::addEffect(EffectType type)
     auto effect = createEffect(type);
     if (effect)
     {
-        EffectInstance instance(nextEffectId++, type, std::move(effect));
-        effects.push_back(std::move(instance));
+        // Delay lines and the like are allocated here, off the audio thread
+        effect->prepareToPlay(blockSize, sampleRate, numChannels);
         
-        // Set as active if it's the first effect
-        if (activeEffectId == -1)
-            activeEffectId = instance.id;
-            
-        return instance.id;
+        const int effectId = nextEffectId++;
+        effects.emplace_back(effectId, type, std::move(effect));
+        return effectId;
     }
     return -1;
 }
@@ -59,12 +85,68 @@ void EffectProcessor::removeEffect(int effectId)
                           [effectId](const EffectInstance& e) { return e.id == effectId; });
     if (it != effects.end())
     {
-        if (activeEffectId == effectId)
-            activeEffectId = -1;
+        // The newest list may still be processing this effect, so it keeps it
+        // alive until the audio thread has moved on to a list without it
+        if (it->effect && publishedRenderList)
+            publishedRenderList->retiredEffects.push_back(std::move(it->effect));
         effects.erase(it);
     }
 }
 
+void EffectProcessor::moveEffect(int effectId, int newIndex)
+{
+    auto it = std::find_if(effects.begin(), effects.end(),
+                          [effectId](const EffectInstance& e) { return e.id == effectId; });
+    if (it != effects.end())
+    {
+        const int oldIndex = static_cast<int>(it - effects.begin());
+        newIndex = juce::jlimit(0, static_cast<int>(effects.size()) - 1, newIndex);
+        
+        if (newIndex < oldIndex)
+            std::rotate(effects.begin() + newIndex, it, it + 1);
+        else if (newIndex > oldIndex)
+            std::rotate(it, it + 1, effects.begin() + newIndex + 1);
+    }
+}
+
+EffectRenderList* EffectProcessor::createRenderList(const std::vector<int>& switchedEffectIds)
+{
+    auto* list = new EffectRenderList();
+    list->entries.reserve(effects.size());
+    list->chain.reserve(effects.size());
+    
+    for (const auto& effectInstance : effects)
+    {
+        EffectRenderList::Entry entry;
+        entry.id = effectInstance.id;
+        entry.effect = effectInstance.effect.get();
+        entry.enabled = effectInstance.enabled;
+        entry.switched = std::find(switchedEffectIds.begin(), switchedEffectIds.end(), effectInstance.id) != switchedEffectIds.end();
+        entry.hasTail = effectInstance.type == EffectType::Delay || effectInstance.type == EffectType::Reverb;
+        list->entries.push_back(entry);
+    }
+    
+    list->updateChain();
+    publishedRenderList = list;
+    return list;
+}
+
+EffectRenderList* EffectProcessor::exchangeRenderList(EffectRenderList* newList)
+{
+    auto* oldList = renderList;
+    renderList = newList;
+    
+    // Voices must not outlive their effect, or play one that's now in the chain
+    switcher.dropVoicesIf([this](int effectId)
+    {
+        auto* entry = findRenderEntry(effectId);
+        return entry == nullptr || !entry->switched;
+    });
+    updateSwitchedEffect();
+    
+    return oldList;
+}
+
 void EffectProcessor::setEffectEnabled(int effectId, bool enabled)
 {
     auto it = std::find_if(effects.begin(), effects.end(),
@@ -89,8 +171,6 @@ void EffectProcessor::setParameter(int effectId, int parameterId, float value)
     if (it != effects.end())
     {
         it->parameters[parameterId] = value;
-        if (it->effect)
-            it->effect->setParameter(parameterId, value);
     }
 }
 
@@ -107,23 +187,111 @@ float EffectProcessor::getParameter(int effectId, int parameterId) const
     return 0.0f;
 }
 
+void EffectProcessor::applyEffectEnabled(int effectId, bool enabled)
+{
+    if (auto* entry = findRenderEntry(effectId))
+    {
+        entry->enabled = enabled;
+        renderList->updateChain();
+        
+        if (effectId == activeEffectId)
+            updateSwitchedEffect();
+    }
+}
+
+void EffectProcessor::applyParameter(int effectId, int parameterId, float value)
+{
+    auto* entry = findRenderEntry(effectId);
+    if (entry && entry->effect)
+        entry->effect->setParameter(parameterId, value);
+}
+
 void EffectProcessor::setActiveEffect(int effectId)
 {
+    if (effectId == activeEffectId)
+        return;
+    
     activeEffectId = effectId;
+    updateSwitchedEffect();
 }
 
 void EffectProcessor::processAudio(juce::AudioBuffer<float>& buffer)
 {
-    // Process only the active effect
-    if (activeEffectId != -1)
+    // Bypassed effects aren't in the chain at all, so they cost nothing
+    const auto& chain = renderList->chain;
+    const bool parallel = workerPool != nullptr && workerPool->getNumWorkers() > 0
+                       && buffer.getNumChannels() > 1 && buffer.getNumSamples() >= minParallelBlockSize;
+
+    for (size_t i = 0; i < chain.size();)
     {
-        auto it = std::find_if(effects.begin(), effects.end(),
-                              [this](const EffectInstance& e) { return e.id == activeEffectId; });
-        if (it != effects.end() && it->enabled && it->effect)
+        size_t runEnd = i;
+        if (parallel)
+        {
+            while (runEnd < chain.size() && chain[runEnd]->hasIndependentChannels())
+                ++runEnd;
+        }
+
+        if (runEnd > i)
+        {
+            processChannelsInParallel(chain.data() + i, static_cast<int>(runEnd - i), buffer);
+            i = runEnd;
+        }
+        else
         {
-            it->effect->processAudio(buffer);
+            chain[i++]->processAudio(buffer);
         }
     }
+    
+    switcher.process(buffer);
+}
+
+void EffectProcessor::processChannelsInParallel(BaseEffect* const* run, int runLength, juce::AudioBuffer<float>& buffer)
+{
+    // Same result as running the effects one after another: each effect's
+    // shared per-block work happens up front, then every channel goes through
+    // the whole run on its own, so a job touches one channel from start to end
+    const int numSamples = buffer.getNumSamples();
+
+    for (int i = 0; i < runLength; ++i)
+        run[i]->beginBlock(numSamples);
+
+    // Fetched here, since asking the buffer for a write pointer also writes to it
+    float* const* channels = buffer.getArrayOfWritePointers();
+
+    auto processChannel = [run, runLength, channels, numSamples](int channel)
+    {
+        for (int i = 0; i < runLength; ++i)
+            run[i]->processChannel(channels[channel], numSamples, channel);
+    };
+
+    workerPool->parallelFor(buffer.getNumChannels(), processChannel);
+}
+
+bool EffectProcessor::isProcessing() const
+{
+    return !renderList->chain.empty() || switcher.getNumAudibleVoices() > 0;
+}
+
+void EffectProcessor::updateSwitchedEffect()
+{
+    auto* entry = findRenderEntry(activeEffectId);
+    if (entry && entry->switched && entry->enabled && entry->effect)
+        switcher.select(entry->id, entry->effect, entry->hasTail);
+    else
+        switcher.select(-1, nullptr, false);
+}
+
+EffectRenderList::Entry* EffectProcessor::findRenderEntry(int effectId)
+{
+    if (renderList == nullptr)
+        return nullptr;
+    
+    for (auto& entry : renderList->entries)
+    {
+        if (entry.id == effectId)
+            return &entry;
+    }
+    return nullptr;
 }
 
 EffectInstance* EffectProcessor::getEffect(int effectId)
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
+#include "Effects/BaseEffect.h"
+#include "EffectSwitcher.h"
+#include "Utils/RealtimeWorkerPool.h"
 #include <memory>
 #include <vector>
 #include <map>
 
-class BaseEffect;
-
 enum class EffectType
 {
     Distortion,
@@ -29,6 +30,34 @@ struct EffectInstance
         : id(effectId), type(effectType), effect(std::move(effectPtr)), enabled(true) {}
 };
 
+// What the audio thread processes: a flat copy of the effect chain, built on the
+// message thread and swapped in whole, so reordering is atomic. Effects removed
+// while a list is current are parked in it, so they outlive the last callback
+// that could still use them.
+struct EffectRenderList
+{
+    struct Entry
+    {
+        int id = -1;
+        BaseEffect* effect = nullptr;
+        bool enabled = true;
+        bool switched = false;  // Selected by triggers through the switcher instead of in the chain
+        bool hasTail = false;   // Keeps sounding after its input stops (delay, reverb)
+    };
+
+    std::vector<Entry> entries;                      // Chain order
+    std::vector<BaseEffect*> chain;                  // Non-bypassed, non-switched effects
+    std::vector<std::unique_ptr<BaseEffect>> retiredEffects;
+
+    EffectRenderList();
+    ~EffectRenderList();
+
+    void updateChain(); // After a bypass change; stays within the reserved capacity
+};
+
+// Effects are owned and edited on the message thread; the audio thread only ever
+// sees them through the current EffectRenderList. Effects that triggers select
+// are switched in and out by the EffectSwitcher after the serial chain.
 class EffectProcessor
 {
 public:
@@ -36,40 +65,64 @@ public:
     ~EffectProcessor();
 
     // Setup
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels);
     void releaseResources();
+    void setWorkerPool(RealtimeWorkerPool* pool) { workerPool = pool; } // Audio stopped; nullptr for serial only
 
-    // Effect management
-    int addEffect(EffectType type);
+    // Effect management (message thread)
+    int addEffect(EffectType type);  // Constructs and prepares the effect here, not in the callback
     void removeEffect(int effectId);
+    void moveEffect(int effectId, int newIndex); // Position in the chain
     void setEffectEnabled(int effectId, bool enabled);
     bool isEffectEnabled(int effectId) const;
+    EffectRenderList* createRenderList(const std::vector<int>& switchedEffectIds); // Caller hands it to the audio thread
 
-    // Parameter management
+    // Parameter management (message thread; values reach the effects via applyParameter)
     void setParameter(int effectId, int parameterId, float value);
     float getParameter(int effectId, int parameterId) const;
-    void setActiveEffect(int effectId);
+
+    // Audio thread
+    EffectRenderList* exchangeRenderList(EffectRenderList* newList); // Returns the list it replaced
+    void applyEffectEnabled(int effectId, bool enabled);
+    void applyParameter(int effectId, int parameterId, float value);
+    void setActiveEffect(int effectId); // Crossfades to a switched effect, -1 for none
     int getActiveEffect() const { return activeEffectId; }
+    EffectSwitcher& getEffectSwitcher() { return switcher; }
 
-    // Audio processing
+    // Audio processing: the chain in order, in place, then the switched effect.
+    // With a worker pool, runs of effects whose channels are independent
+    // process each channel as a job of its own; shorter blocks stay serial,
+    // where waking the workers would cost more than it saves.
     void processAudio(juce::AudioBuffer<float>& buffer);
+    static constexpr int minParallelBlockSize = 256;
+    bool isProcessing() const; // False when processAudio would leave the audio untouched
 
     // Getters
     const std::vector<EffectInstance>& getEffects() const { return effects; }
     EffectInstance* getEffect(int effectId);
 
 private:
-    // Effects
+    // Effects (message thread)
     std::vector<EffectInstance> effects;
     int nextEffectId = 1;
+    EffectRenderList* publishedRenderList = nullptr; // Newest list handed out, not owned
+
+    // Audio thread
+    EffectRenderList* renderList = nullptr;
+    EffectSwitcher switcher;
     int activeEffectId = -1;
+    RealtimeWorkerPool* workerPool = nullptr;
 
     // Audio parameters
     double sampleRate = 44100.0;
     int blockSize = 256;
+    int numChannels = 2;
 
     // Helper methods
     std::unique_ptr<BaseEffect> createEffect(EffectType type);
+    EffectRenderList::Entry* findRenderEntry(int effectId);
+    void updateSwitchedEffect();
+    void processChannelsInParallel(BaseEffect* const* run, int runLength, juce::AudioBuffer<float>& buffer);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EffectProcessor)
 }; 
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "EffectSwitcher.h"
+
+EffectSwitcher::EffectSwitcher()
+{
+}
+
+EffectSwitcher::~EffectSwitcher()
+{
+}
+
+void EffectSwitcher::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels)
+{
+    this->sampleRate = sampleRate;
+    this->blockSize = samplesPerBlockExpected;
+
+    dryBuffer.setSize(numChannels, samplesPerBlockExpected);
+    for (auto& voice : voices)
+        voice.buffer.setSize(numChannels, samplesPerBlockExpected);
+
+    reset();
+}
+
+void EffectSwitcher::releaseResources()
+{
+    reset();
+
+    dryBuffer.setSize(0, 0);
+    for (auto& voice : voices)
+        voice.buffer.setSize(0, 0);
+}
+
+void EffectSwitcher::setCrossfadeTime(float milliseconds)
+{
+    crossfadeMs.store(juce::jlimit(0.0f, 2000.0f, milliseconds));
+}
+
+void EffectSwitcher::setTailThreshold(float gain)
+{
+    tailThreshold.store(juce::jlimit(0.0f, 1.0f, gain));
+}
+
+void EffectSwitcher::setMaxTailTime(float milliseconds)
+{
+    maxTailMs.store(juce::jlimit(0.0f, 60000.0f, milliseconds));
+}
+
+void EffectSwitcher::select(int effectId, BaseEffect* effect, bool hasTail)
+{
+    if (effect == nullptr)
+        effectId = -1;
+
+    if (effectId == selectedEffectId)
+        return;
+
+    selectedEffectId = effectId;
+
+    // Everything that's sounding fades out...
+    for (auto& voice : voices)
+        voice.target = 0.0f;
+
+    if (effect == nullptr)
+        return;
+
+    // ...and the new effect fades in, picking up where it was if it's still fading out
+    auto* voice = findVoice(effectId);
+    if (voice == nullptr)
+    {
+        voice = allocateVoice();
+        voice->level = 0.0f;
+    }
+
+    voice->effectId = effectId;
+    voice->effect = effect;
+    voice->hasTail = hasTail;
+    voice->target = 1.0f;
+    voice->tailSamples = 0;
+}
+
+void EffectSwitcher::process(juce::AudioBuffer<float>& buffer)
+{
+    // With nothing selected and no tails left the dry signal passes untouched
+    if (getNumAudibleVoices() == 0)
+        return;
+
+    jassert(buffer.getNumSamples() <= dryBuffer.getNumSamples());
+    const int numSamples = juce::jmin(buffer.getNumSamples(), dryBuffer.getNumSamples());
+    const int numChannels = juce::jmin(buffer.getNumChannels(), dryBuffer.getNumChannels());
+    const float step = getRampStep(numSamples);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        dryBuffer.copyFrom(channel, 0, buffer, channel, 0, numSamples);
+
+    // Advance the ramps; the dry signal gets whatever share the voices leave
+    std::array<float, maxVoices> startLevels {};
+    float dryStart = 1.0f;
+    float dryEnd = 1.0f;
+
+    for (int i = 0; i < maxVoices; ++i)
+    {
+        auto& voice = voices[i];
+        if (voice.effect == nullptr)
+            continue;
+
+        startLevels[i] = voice.level;
+        voice.level = voice.target > voice.level ? juce::jmin(voice.target, voice.level + step)
+                                                 : juce::jmax(voice.target, voice.level - step);
+        dryStart -= startLevels[i];
+        dryEnd -= voice.level;
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        buffer.applyGainRamp(channel, 0, numSamples, juce::jmax(0.0f, dryStart), juce::jmax(0.0f, dryEnd));
+
+    const float threshold = tailThreshold.load();
+    const auto maxTailSamples = static_cast<juce::int64>(maxTailMs.load() * 0.001 * sampleRate);
+
+    for (int i = 0; i < maxVoices; ++i)
+    {
+        auto& voice = voices[i];
+        if (voice.effect == nullptr)
+            continue;
+
+        // Within the prepared size, so this never reallocates
+        voice.buffer.setSize(numChannels, numSamples, false, false, true);
+        for (int channel = 0; channel < numChannels; ++channel)
+            voice.buffer.copyFrom(channel, 0, dryBuffer, channel, 0, numSamples);
+
+        // A tail effect fades its input and keeps its output, so the tail survives
+        if (voice.hasTail)
+            voice.buffer.applyGainRamp(0, numSamples, startLevels[i], voice.level);
+
+        voice.effect->processAudio(voice.buffer);
+
+        const float outputStart = voice.hasTail ? 1.0f : startLevels[i];
+        const float outputEnd = voice.hasTail ? 1.0f : voice.level;
+        for (int channel = 0; channel < numChannels; ++channel)
+            buffer.addFromWithRamp(channel, 0, voice.buffer.getReadPointer(channel), numSamples, outputStart, outputEnd);
+
+        // Fully faded out: done, unless there's a tail still ringing
+        if (voice.target == 0.0f && voice.level == 0.0f)
+        {
+            if (!voice.hasTail)
+            {
+                freeVoice(voice);
+                continue;
+            }
+
+            float peak = 0.0f;
+            for (int channel = 0; channel < numChannels; ++channel)
+                peak = juce::jmax(peak, voice.buffer.getMagnitude(channel, 0, numSamples));
+
+            voice.tailSamples += numSamples;
+            if (peak < threshold || voice.tailSamples >= maxTailSamples)
+                freeVoice(voice);
+        }
+    }
+}
+
+void EffectSwitcher::reset()
+{
+    for (auto& voice : voices)
+        freeVoice(voice);
+
+    selectedEffectId = -1;
+}
+
+int EffectSwitcher::getNumAudibleVoices() const
+{
+    int count = 0;
+    for (const auto& voice : voices)
+    {
+        if (voice.effect != nullptr)
+            ++count;
+    }
+    return count;
+}
+
+EffectSwitcher::Voice* EffectSwitcher::findVoice(int effectId)
+{
+    for (auto& voice : voices)
+    {
+        if (voice.effect != nullptr && voice.effectId == effectId)
+            return &voice;
+    }
+    return nullptr;
+}
+
+EffectSwitcher::Voice* EffectSwitcher::allocateVoice()
+{
+    Voice* quietest = nullptr;
+
+    for (auto& voice : voices)
+    {
+        if (voice.effect == nullptr)
+            return &voice;
+
+        // Only the selected voice is fading in, so there's always one fading out to take
+        if (voice.target == 0.0f && (quietest == nullptr || voice.level < quietest->level))
+            quietest = &voice;
+    }
+
+    freeVoice(*quietest);
+    return quietest;
+}
+
+void EffectSwitcher::freeVoice(Voice& voice)
+{
+    voice.effectId = -1;
+    voice.effect = nullptr;
+    voice.hasTail = false;
+    voice.level = 0.0f;
+    voice.target = 0.0f;
+    voice.tailSamples = 0;
+}
+
+float EffectSwitcher::getRampStep(int numSamples) const
+{
+    const double crossfadeSamples = crossfadeMs.load() * 0.001 * sampleRate;
+    return crossfadeSamples > 1.0 ? static_cast<float>(numSamples / crossfadeSamples) : 1.0f;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "Effects/BaseEffect.h"
+#include <array>
+#include <atomic>
+
+// Click-free switching between trigger-selected effects. Each selected effect
+// runs in a voice on its own copy of the input; a switch ramps the outgoing voice
+// down and the incoming one up over the crossfade time, with the dry signal
+// filling whatever the voices leave. Tail effects (delay, reverb) fade their
+// input instead of their output, so the tail rings on until it decays below the
+// threshold. Idle voices cost nothing.
+class EffectSwitcher
+{
+public:
+    EffectSwitcher();
+    ~EffectSwitcher();
+
+    // Setup (allocates the voice buffers)
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels);
+    void releaseResources();
+
+    // Settings (any thread)
+    void setCrossfadeTime(float milliseconds);
+    void setTailThreshold(float gain);     // Peak level below which a tail is done
+    void setMaxTailTime(float milliseconds);
+
+    // Audio thread
+    void select(int effectId, BaseEffect* effect, bool hasTail); // nullptr switches to dry
+    void process(juce::AudioBuffer<float>& buffer);
+    void reset();                                               // Cuts every voice
+    int getNumAudibleVoices() const;
+
+    template <typename Predicate>
+    void dropVoicesIf(Predicate shouldDrop) // Predicate(int effectId); cuts without a fade
+    {
+        for (auto& voice : voices)
+        {
+            if (voice.effect != nullptr && shouldDrop(voice.effectId))
+                freeVoice(voice);
+        }
+    }
+
+    static constexpr int maxVoices = 4;
+
+private:
+    struct Voice
+    {
+        juce::AudioBuffer<float> buffer;
+        int effectId = -1;
+        BaseEffect* effect = nullptr;   // nullptr when the voice is free
+        bool hasTail = false;
+        float level = 0.0f;
+        float target = 0.0f;
+        juce::int64 tailSamples = 0;    // Since the input faded out
+    };
+
+    // Settings
+    std::atomic<float> crossfadeMs { 30.0f };
+    std::atomic<float> tailThreshold { 0.001f }; // -60 dB
+    std::atomic<float> maxTailMs { 10000.0f };
+
+    // Voices
+    std::array<Voice, maxVoices> voices;
+    juce::AudioBuffer<float> dryBuffer;
+    int selectedEffectId = -1;
+
+    // Audio parameters
+    double sampleRate = 44100.0;
+    int blockSize = 256;
+
+    // Helper methods
+    Voice* findVoice(int effectId);
+    Voice* allocateVoice();
+    static void freeVoice(Voice& voice);
+    float getRampStep(int numSamples) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EffectSwitcher)
+};
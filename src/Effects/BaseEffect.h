@@ -1,6 +1,9 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
+#include "SmoothedParameter.h"
+#include <initializer_list>
+#include <vector>
 
 class BaseEffect
 {
@@ -8,12 +11,31 @@ public:
     BaseEffect() = default;
     virtual ~BaseEffect() = default;
 
-    // Setup
-    virtual void prepareToPlay(int samplesPerBlockExpected, double sampleRate) = 0;
+    // Setup. processChannel is only called with channels below numChannels.
+    virtual void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels) = 0;
     virtual void releaseResources() = 0;
 
-    // Audio processing
-    virtual void processAudio(juce::AudioBuffer<float>& buffer) = 0;
+    // Audio processing. By default a block runs through the contract below:
+    // beginBlock() once, then processChannel() on each channel in turn.
+    virtual void processAudio(juce::AudioBuffer<float>& buffer)
+    {
+        const int numSamples = buffer.getNumSamples();
+        beginBlock(numSamples);
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            processChannel(buffer.getWritePointer(channel), numSamples, channel);
+    }
+
+    // Block processing contract. beginBlock does the work every channel shares
+    // (advancing smoothed parameters, ramped coefficients); processChannel then
+    // runs one channel's samples through the effect's block kernels, with no
+    // per-sample virtual calls.
+    virtual void beginBlock(int numSamples) { advanceSmoothedParameters(numSamples); }
+    virtual void processChannel(float* samples, int numSamples, int channel) = 0;
+
+    // True when processChannel calls for different channels share no state
+    // (after beginBlock), so a block's channels can be processed concurrently
+    virtual bool hasIndependentChannels() const { return false; }
 
     // Parameter management
     virtual void setParameter(int parameterId, float value) = 0;
@@ -31,4 +53,33 @@ public:
 protected:
     double sampleRate = 44100.0;
     int blockSize = 256;
-}; 
\ No newline at end of file
+    int numChannels = 2;
+
+    // Smoothed parameters: register them once in the constructor, then prepare,
+    // advance (once per block, before reading them) and release them together
+    void registerSmoothedParameters(std::initializer_list<SmoothedParameter*> parameters)
+    {
+        smoothedParameters.insert(smoothedParameters.end(), parameters);
+    }
+
+    void prepareSmoothedParameters()
+    {
+        for (auto* parameter : smoothedParameters)
+            parameter->prepare(sampleRate, blockSize);
+    }
+
+    void advanceSmoothedParameters(int numSamples)
+    {
+        for (auto* parameter : smoothedParameters)
+            parameter->advance(numSamples);
+    }
+
+    void releaseSmoothedParameters()
+    {
+        for (auto* parameter : smoothedParameters)
+            parameter->release();
+    }
+
+private:
+    std::vector<SmoothedParameter*> smoothedParameters;
+};
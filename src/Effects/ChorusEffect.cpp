@@ -3,16 +3,18 @@
 
 ChorusEffect::ChorusEffect()
 {
+    registerSmoothedParameters({ &rate, &depth, &mix });
 }
 
 ChorusEffect::~ChorusEffect()
 {
 }
 
-void ChorusEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void ChorusEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels)
 {
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
+    this->numChannels = numChannels;
     
     // Initialize delay buffer (max 50ms delay)
     delayBufferSize = static_cast<int>(0.05f * sampleRate);
@@ -20,7 +22,7 @@ void ChorusEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
     std::fill(delayBuffer.begin(), delayBuffer.end(), 0.0f);
     writeIndex = 0;
     
-    updateLFO();
+    prepareSmoothedParameters();
 }
 
 void ChorusEffect::releaseResources()
@@ -29,25 +31,58 @@ void ChorusEffect::releaseResources()
     delayBufferSize = 0;
     writeIndex = 0;
     lfoPhase = 0.0f;
+
+    releaseSmoothedParameters();
 }
 
-void ChorusEffect::processAudio(juce::AudioBuffer<float>& buffer)
+void ChorusEffect::beginBlock(int numSamples)
 {
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    BaseEffect::beginBlock(numSamples);
+
+    // The LFO increment only needs recomputing per sample while the rate is moving
+    lfoIncrement = calculateLFOIncrement(rate.getCurrentValue());
+}
+
+void ChorusEffect::processChannel(float* samples, int numSamples, int channel)
+{
+    if (delayBufferSize == 0)
+        return;
+
+    float* buffer = delayBuffer.data();
+    int index = writeIndex;
+
+    for (int sample = 0; sample < numSamples; ++sample)
     {
-        float* channelData = buffer.getWritePointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-        {
-            float input = channelData[sample];
-            float processed = processSample(input);
-            
-            // Mix dry and wet signals
-            channelData[sample] = input * (1.0f - mix) + processed * mix;
-            
-            // Update LFO
-            updateLFO();
-        }
+        const float input = samples[sample];
+        buffer[index] = input;
+
+        // Read behind the write point by the LFO-modulated delay
+        const float delayOffset = getLFOValue() * depth.getValue(sample) * delayBufferSize * 0.5f;
+        float readPosition = index - delayOffset;
+
+        while (readPosition < 0)
+            readPosition += delayBufferSize;
+        while (readPosition >= delayBufferSize)
+            readPosition -= delayBufferSize;
+
+        // Linear interpolation
+        const int readIndex = static_cast<int>(readPosition);
+        const float fraction = readPosition - readIndex;
+        const int nextIndex = readIndex + 1 < delayBufferSize ? readIndex + 1 : 0;
+        const float processed = buffer[readIndex] + fraction * (buffer[nextIndex] - buffer[readIndex]);
+
+        if (++index == delayBufferSize)
+            index = 0;
+
+        // Mix dry and wet signals
+        const float wet = mix.getValue(sample);
+        samples[sample] = input * (1.0f - wet) + processed * wet;
+        
+        // Update LFO
+        advanceLFO(rate.isRamping() ? calculateLFOIncrement(rate.getValue(sample)) : lfoIncrement);
     }
+
+    writeIndex = index;
 }
 
 void ChorusEffect::setParameter(int parameterId, float value)
@@ -55,14 +90,13 @@ void ChorusEffect::setParameter(int parameterId, float value)
     switch (parameterId)
     {
         case Rate:
-            rate = juce::jlimit(0.1f, 10.0f, value);
-            updateLFO();
+            rate.setTargetValue(juce::jlimit(0.1f, 10.0f, value));
             break;
         case Depth:
-            depth = juce::jlimit(0.0f, 1.0f, value);
+            depth.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
         case Mix:
-            mix = juce::jlimit(0.0f, 1.0f, value);
+            mix.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
     }
 }
@@ -71,9 +105,9 @@ float ChorusEffect::getParameter(int parameterId) const
 {
     switch (parameterId)
     {
-        case Rate: return rate;
-        case Depth: return depth;
-        case Mix: return mix;
+        case Rate: return rate.getTargetValue();
+        case Depth: return depth.getTargetValue();
+        case Mix: return mix.getTargetValue();
         default: return 0.0f;
     }
 }
@@ -122,10 +156,14 @@ float ChorusEffect::getParameterMaxValue(int parameterId) const
     }
 }
 
-void ChorusEffect::updateLFO()
+float ChorusEffect::calculateLFOIncrement(float rateValue) const
 {
-    lfoIncrement = 2.0f * M_PI * rate / sampleRate;
-    lfoPhase += lfoIncrement;
+    return 2.0f * M_PI * rateValue / sampleRate;
+}
+
+void ChorusEffect::advanceLFO(float increment)
+{
+    lfoPhase += increment;
     
     // Keep phase in range [0, 2π]
     while (lfoPhase >= 2.0f * M_PI)
@@ -137,37 +175,3 @@ float ChorusEffect::getLFOValue()
     // Sine wave LFO
     return std::sin(lfoPhase);
 }
-
-float ChorusEffect::processSample(float input)
-{
-    if (delayBufferSize == 0)
-        return input;
-    
-    // Write to delay buffer
-    delayBuffer[writeIndex] = input;
-    
-    // Calculate modulated delay time
-    float lfoValue = getLFOValue();
-    float delayOffset = lfoValue * depth * delayBufferSize * 0.5f;
-    float readIndex = writeIndex - delayOffset;
-    
-    // Handle wrap-around
-    while (readIndex < 0)
-        readIndex += delayBufferSize;
-    while (readIndex >= delayBufferSize)
-        readIndex -= delayBufferSize;
-    
-    // Linear interpolation
-    int readIndexInt = static_cast<int>(readIndex);
-    float fraction = readIndex - readIndexInt;
-    int nextIndex = (readIndexInt + 1) % delayBufferSize;
-    
-    float delayed1 = delayBuffer[readIndexInt];
-    float delayed2 = delayBuffer[nextIndex];
-    float delayed = delayed1 + fraction * (delayed2 - delayed1);
-    
-    // Update write index
-    writeIndex = (writeIndex + 1) % delayBufferSize;
-    
-    return delayed;
-} 
\ No newline at end of file
@@ -10,11 +10,12 @@ public:
     ~ChorusEffect() override;
 
     // Setup
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels) override;
     void releaseResources() override;
 
     // Audio processing
-    void processAudio(juce::AudioBuffer<float>& buffer) override;
+    void beginBlock(int numSamples) override;
+    void processChannel(float* samples, int numSamples, int channel) override;
 
     // Parameter management
     void setParameter(int parameterId, float value) override;
@@ -39,13 +40,13 @@ public:
 
 private:
     // Parameters
-    float rate = 1.0f;    // Hz
-    float depth = 0.5f;   // 0-1
-    float mix = 0.5f;     // 0-1
+    SmoothedParameter rate { 1.0f, SmoothedParameter::Ramp::Exponential }; // Hz
+    SmoothedParameter depth { 0.5f };   // 0-1
+    SmoothedParameter mix { 0.5f };     // 0-1
 
     // LFO state
     float lfoPhase = 0.0f;
-    float lfoIncrement = 0.0f;
+    float lfoIncrement = 0.0f; // For the current, static rate
 
     // Delay buffer
     std::vector<float> delayBuffer;
@@ -53,9 +54,9 @@ private:
     int writeIndex = 0;
 
     // Processing
-    void updateLFO();
+    float calculateLFOIncrement(float rateValue) const;
+    void advanceLFO(float increment);
     float getLFOValue();
-    float processSample(float input);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChorusEffect)
 }; 
\ No newline at end of file
@@ -3,35 +3,40 @@
 
 CompressorEffect::CompressorEffect()
 {
+    registerSmoothedParameters({ &threshold, &ratio, &makeupGainLinear });
 }
 
 CompressorEffect::~CompressorEffect()
 {
 }
 
-void CompressorEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void CompressorEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels)
 {
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
+    this->numChannels = numChannels;
     
     updateCoefficients();
+    gains.assign(samplesPerBlockExpected, 1.0f);
+    prepareSmoothedParameters();
 }
 
 void CompressorEffect::releaseResources()
 {
     envelope = 0.0f;
+    gains.clear();
+    releaseSmoothedParameters();
 }
 
-void CompressorEffect::processAudio(juce::AudioBuffer<float>& buffer)
+void CompressorEffect::processChannel(float* samples, int numSamples, int channel)
 {
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-    {
-        float* channelData = buffer.getWritePointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-        {
-            channelData[sample] = processSample(channelData[sample], channel);
-        }
-    }
+    if (gains.empty())
+        return;
+
+    // In runs the scratch can hold; a block is normally a single run
+    const int maxRun = static_cast<int>(gains.size());
+    for (int start = 0; start < numSamples; start += maxRun)
+        compressRun(samples + start, juce::jmin(maxRun, numSamples - start), start);
 }
 
 void CompressorEffect::setParameter(int parameterId, float value)
@@ -39,10 +44,10 @@ void CompressorEffect::setParameter(int parameterId, float value)
     switch (parameterId)
     {
         case Threshold:
-            threshold = juce::jlimit(-60.0f, 0.0f, value);
+            threshold.setTargetValue(juce::jlimit(-60.0f, 0.0f, value));
             break;
         case Ratio:
-            ratio = juce::jlimit(1.0f, 20.0f, value);
+            ratio.setTargetValue(juce::jlimit(1.0f, 20.0f, value));
             break;
         case Attack:
             attack = juce::jlimit(0.1f, 100.0f, value);
@@ -54,7 +59,7 @@ void CompressorEffect::setParameter(int parameterId, float value)
             break;
         case MakeupGain:
             makeupGain = juce::jlimit(0.0f, 24.0f, value);
-            makeupGainLinear = std::pow(10.0f, makeupGain / 20.0f);
+            makeupGainLinear.setTargetValue(std::pow(10.0f, makeupGain / 20.0f));
             break;
     }
 }
@@ -63,8 +68,8 @@ float CompressorEffect::getParameter(int parameterId) const
 {
     switch (parameterId)
     {
-        case Threshold: return threshold;
-        case Ratio: return ratio;
+        case Threshold: return threshold.getTargetValue();
+        case Ratio: return ratio.getTargetValue();
         case Attack: return attack;
         case Release: return release;
         case MakeupGain: return makeupGain;
@@ -131,45 +136,57 @@ void CompressorEffect::updateCoefficients()
     releaseCoeff = std::exp(-1000.0f / (release * sampleRate));
 }
 
-float CompressorEffect::processSample(float input, int channel)
+void CompressorEffect::compressRun(float* samples, int numSamples, int startSample)
 {
-    // Calculate input level in dB
-    float inputLevel = 20.0f * std::log10(std::abs(input) + 1e-6f);
-    
-    // Update envelope
-    if (inputLevel > envelope)
+    float* gain = gains.data();
+
+    // Rectify
+    juce::FloatVectorOperations::abs(gain, samples, numSamples);
+
+    // Envelope follower in dB. It's recursive, so this loop stays scalar; it
+    // leaves the gain reduction for each sample in dB
+    bool compressing = false;
+    for (int i = 0; i < numSamples; ++i)
     {
-        envelope = attackCoeff * (envelope - inputLevel) + inputLevel;
+        // Calculate input level in dB
+        float inputLevel = 20.0f * std::log10(gain[i] + 1e-6f);
+        
+        // Update envelope
+        float coeff = inputLevel > envelope ? attackCoeff : releaseCoeff;
+        envelope = coeff * (envelope - inputLevel) + inputLevel;
+        
+        // Calculate gain reduction
+        const int sample = startSample + i;
+        gain[i] = calculateGainReduction(envelope, threshold.getValue(sample), ratio.getValue(sample));
+        compressing = compressing || gain[i] < 0.0f;
     }
-    else
+
+    // Apply compression, unless the whole run stayed below threshold
+    if (compressing)
     {
-        envelope = releaseCoeff * (envelope - inputLevel) + inputLevel;
+        // dB to linear: 10^(x / 20) = e^(x * ln(10) / 20)
+        for (int i = 0; i < numSamples; ++i)
+            gain[i] = std::exp(gain[i] * 0.115129255f);
+
+        juce::FloatVectorOperations::multiply(samples, gain, numSamples);
     }
-    
-    // Calculate gain reduction
-    float gainReduction = calculateGainReduction(envelope);
-    
-    // Apply compression and makeup gain
-    float output = input * gainReduction * makeupGainLinear;
-    
-    return output;
+
+    // Apply makeup gain
+    makeupGainLinear.applyGain(samples, numSamples, startSample);
 }
 
-float CompressorEffect::calculateGainReduction(float inputLevel)
+float CompressorEffect::calculateGainReduction(float inputLevel, float thresholdValue, float ratioValue)
 {
-    if (inputLevel <= threshold)
+    if (inputLevel <= thresholdValue)
     {
-        return 1.0f; // No compression below threshold
+        return 0.0f; // No compression below threshold
     }
     
     // Calculate how much the signal exceeds the threshold
-    float overThreshold = inputLevel - threshold;
+    float overThreshold = inputLevel - thresholdValue;
     
     // Calculate compression amount
-    float compressionAmount = overThreshold * (1.0f - 1.0f / ratio);
-    
-    // Convert to linear gain
-    float gainReduction = std::pow(10.0f, -compressionAmount / 20.0f);
+    float compressionAmount = overThreshold * (1.0f - 1.0f / ratioValue);
     
-    return gainReduction;
+    return -compressionAmount;
 } 
\ No newline at end of file
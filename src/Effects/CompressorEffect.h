@@ -1,6 +1,7 @@
 #pragma once
 
 #include "BaseEffect.h"
+#include <vector>
 
 class CompressorEffect : public BaseEffect
 {
@@ -9,11 +10,11 @@ public:
     ~CompressorEffect() override;
 
     // Setup
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels) override;
     void releaseResources() override;
 
     // Audio processing
-    void processAudio(juce::AudioBuffer<float>& buffer) override;
+    void processChannel(float* samples, int numSamples, int channel) override;
 
     // Parameter management
     void setParameter(int parameterId, float value) override;
@@ -40,8 +41,8 @@ public:
 
 private:
     // Parameters
-    float threshold = -20.0f; // dB
-    float ratio = 4.0f;
+    SmoothedParameter threshold { -20.0f }; // dB
+    SmoothedParameter ratio { 4.0f };
     float attack = 10.0f; // ms
     float release = 100.0f; // ms
     float makeupGain = 0.0f; // dB
@@ -50,12 +51,15 @@ private:
     float envelope = 0.0f;
     float attackCoeff = 0.0f;
     float releaseCoeff = 0.0f;
-    float makeupGainLinear = 1.0f;
+    SmoothedParameter makeupGainLinear { 1.0f, SmoothedParameter::Ramp::Exponential };
+
+    // Block scratch: rectified input, then the gain for each sample
+    std::vector<float> gains;
 
     // Processing
     void updateCoefficients();
-    float processSample(float input, int channel);
-    float calculateGainReduction(float inputLevel);
+    void compressRun(float* samples, int numSamples, int startSample);
+    float calculateGainReduction(float inputLevel, float thresholdValue, float ratioValue); // dB, <= 0
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompressorEffect)
 }; 
\ No newline at end of file
@@ -3,41 +3,85 @@
 
 DelayEffect::DelayEffect()
 {
+    registerSmoothedParameters({ &delayTime, &feedback, &mix });
 }
 
 DelayEffect::~DelayEffect()
 {
 }
 
-void DelayEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void DelayEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels)
 {
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
+    this->numChannels = numChannels;
     
-    updateDelayBuffer();
+    // Room for the longest delay plus the interpolation neighbour
+    delayBufferSize = static_cast<int>(maxDelayTime * sampleRate) + 2;
+    delayBuffers.assign(numChannels, std::vector<float>(delayBufferSize, 0.0f));
+    writeIndex = 0;
+    blockStartIndex = 0;
+
+    prepareSmoothedParameters();
 }
 
 void DelayEffect::releaseResources()
 {
-    delayBuffer.clear();
+    delayBuffers.clear();
     delayBufferSize = 0;
     writeIndex = 0;
-    readIndex = 0;
+    blockStartIndex = 0;
+
+    releaseSmoothedParameters();
 }
 
-void DelayEffect::processAudio(juce::AudioBuffer<float>& buffer)
+void DelayEffect::beginBlock(int numSamples)
 {
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    BaseEffect::beginBlock(numSamples);
+
+    if (delayBufferSize == 0)
+        return;
+
+    blockStartIndex = writeIndex;
+    writeIndex = (writeIndex + numSamples) % delayBufferSize;
+}
+
+void DelayEffect::processChannel(float* samples, int numSamples, int channel)
+{
+    if (channel >= static_cast<int>(delayBuffers.size()))
+        return;
+
+    const float samplesPerSecond = static_cast<float>(sampleRate);
+    const float bufferLength = static_cast<float>(delayBufferSize);
+    float* delayBuffer = delayBuffers[channel].data();
+    int index = blockStartIndex;
+
+    for (int sample = 0; sample < numSamples; ++sample)
     {
-        float* channelData = buffer.getWritePointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-        {
-            float input = channelData[sample];
-            float processed = processSample(input);
-            
-            // Mix dry and wet signals
-            channelData[sample] = input * (1.0f - mix) + processed * mix;
-        }
+        const float input = samples[sample];
+
+        // Read delayed sample, interpolating so the read point can glide
+        float readPosition = static_cast<float>(index) - delayTime.getValue(sample) * samplesPerSecond;
+        if (readPosition < 0.0f)
+            readPosition += bufferLength;
+
+        int readIndex = static_cast<int>(readPosition);
+        const float fraction = readPosition - static_cast<float>(readIndex);
+        if (readIndex >= delayBufferSize) // Float rounding at the wrap point
+            readIndex -= delayBufferSize;
+        const int nextIndex = readIndex + 1 < delayBufferSize ? readIndex + 1 : 0;
+        const float delayed = delayBuffer[readIndex] + fraction * (delayBuffer[nextIndex] - delayBuffer[readIndex]);
+
+        // Input plus feedback goes back into the line and out as the wet signal
+        const float processed = input + feedback.getValue(sample) * delayed;
+        delayBuffer[index] = processed;
+
+        // Mix dry and wet signals
+        const float wet = mix.getValue(sample);
+        samples[sample] = input * (1.0f - wet) + processed * wet;
+
+        if (++index == delayBufferSize)
+            index = 0;
     }
 }
 
@@ -46,14 +90,13 @@ void DelayEffect::setParameter(int parameterId, float value)
     switch (parameterId)
     {
         case Time:
-            delayTime = juce::jlimit(0.01f, 2.0f, value);
-            updateDelayBuffer();
+            delayTime.setTargetValue(juce::jlimit(0.01f, maxDelayTime, value));
             break;
         case Feedback:
-            feedback = juce::jlimit(0.0f, 0.9f, value);
+            feedback.setTargetValue(juce::jlimit(0.0f, 0.9f, value));
             break;
         case Mix:
-            mix = juce::jlimit(0.0f, 1.0f, value);
+            mix.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
     }
 }
@@ -62,9 +105,9 @@ float DelayEffect::getParameter(int parameterId) const
 {
     switch (parameterId)
     {
-        case Time: return delayTime;
-        case Feedback: return feedback;
-        case Mix: return mix;
+        case Time: return delayTime.getTargetValue();
+        case Feedback: return feedback.getTargetValue();
+        case Mix: return mix.getTargetValue();
         default: return 0.0f;
     }
 }
@@ -112,39 +155,3 @@ float DelayEffect::getParameterMaxValue(int parameterId) const
         default: return 1.0f;
     }
 }
-
-void DelayEffect::updateDelayBuffer()
-{
-    // Calculate delay buffer size
-    int delaySamples = static_cast<int>(delayTime * sampleRate);
-    delayBufferSize = delaySamples;
-    
-    // Resize buffer
-    delayBuffer.resize(delayBufferSize);
-    std::fill(delayBuffer.begin(), delayBuffer.end(), 0.0f);
-    
-    // Reset indices
-    writeIndex = 0;
-    readIndex = 0;
-}
-
-float DelayEffect::processSample(float input)
-{
-    if (delayBufferSize == 0)
-        return input;
-    
-    // Read delayed sample
-    float delayed = delayBuffer[readIndex];
-    
-    // Calculate output (input + feedback * delayed)
-    float output = input + feedback * delayed;
-    
-    // Write to delay buffer
-    delayBuffer[writeIndex] = output;
-    
-    // Update indices
-    writeIndex = (writeIndex + 1) % delayBufferSize;
-    readIndex = (readIndex + 1) % delayBufferSize;
-    
-    return output;
-} 
\ No newline at end of file
@@ -10,11 +10,13 @@ public:
     ~DelayEffect() override;
 
     // Setup
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels) override;
     void releaseResources() override;
 
     // Audio processing
-    void processAudio(juce::AudioBuffer<float>& buffer) override;
+    void beginBlock(int numSamples) override;
+    void processChannel(float* samples, int numSamples, int channel) override;
+    bool hasIndependentChannels() const override { return true; }
 
     // Parameter management
     void setParameter(int parameterId, float value) override;
@@ -38,20 +40,20 @@ public:
     };
 
 private:
-    // Parameters
-    float delayTime = 0.3f;  // seconds
-    float feedback = 0.3f;
-    float mix = 0.5f;
+    static constexpr float maxDelayTime = 2.0f; // seconds
 
-    // Delay buffer
-    std::vector<float> delayBuffer;
+    // Parameters (time glides a little slower, so a sweep bends pitch rather than clicking)
+    SmoothedParameter delayTime { 0.3f, SmoothedParameter::Ramp::Linear, 0.1 }; // seconds
+    SmoothedParameter feedback { 0.3f };
+    SmoothedParameter mix { 0.5f };
+
+    // Delay buffers, one per channel, sized for the longest delay so time changes never reallocate
+    std::vector<std::vector<float>> delayBuffers;
     int delayBufferSize = 0;
     int writeIndex = 0;
-    int readIndex = 0;
+    int blockStartIndex = 0; // Write position at the start of the current block, shared by every channel
 
     // Processing
-    void updateDelayBuffer();
-    float processSample(float input);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DelayEffect)
 }; 
\ No newline at end of file
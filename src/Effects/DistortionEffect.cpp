@@ -1,34 +1,94 @@
 #include "DistortionEffect.h"
+#include "AudioUtils.h"
 #include <cmath>
 
 DistortionEffect::DistortionEffect()
 {
+    registerSmoothedParameters({ &drive, &tone, &level });
 }
 
 DistortionEffect::~DistortionEffect()
 {
 }
 
-void DistortionEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void DistortionEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels)
 {
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
+    this->numChannels = numChannels;
+
+    toneFilterOutputs.assign(numChannels, 0.0f);
+    driveGains.assign(samplesPerBlockExpected, 1.0f);
+    toneAlphas.assign(samplesPerBlockExpected, 1.0f);
+    prepareSmoothedParameters();
 }
 
 void DistortionEffect::releaseResources()
 {
+    toneFilterOutputs.clear();
+    driveGains.clear();
+    toneAlphas.clear();
+    releaseSmoothedParameters();
 }
 
-void DistortionEffect::processAudio(juce::AudioBuffer<float>& buffer)
+void DistortionEffect::beginBlock(int numSamples)
 {
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    BaseEffect::beginBlock(numSamples);
+
+    // Drive gain, 1x to 11x
+    if (drive.isRamping())
+    {
+        juce::FloatVectorOperations::copyWithMultiply(driveGains.data(), drive.getRampValues(), 10.0f, numSamples);
+        juce::FloatVectorOperations::add(driveGains.data(), 1.0f, numSamples);
+    }
+
+    // The tone coefficient only needs recomputing per sample while tone is moving
+    if (tone.isRamping())
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+            toneAlphas[sample] = calculateToneAlpha(tone.getValue(sample));
+    }
+    else
+    {
+        toneAlpha = calculateToneAlpha(tone.getCurrentValue());
+    }
+}
+
+void DistortionEffect::processChannel(float* samples, int numSamples, int channel)
+{
+    if (channel >= static_cast<int>(toneFilterOutputs.size()))
+        return;
+
+    // Drive into a soft clipper
+    if (drive.isRamping())
+        juce::FloatVectorOperations::multiply(samples, driveGains.data(), numSamples);
+    else
+        juce::FloatVectorOperations::multiply(samples, 1.0f + drive.getCurrentValue() * 10.0f, numSamples);
+
+    AudioUtils::softClip(samples, numSamples);
+
+    // Tone: first-order low-pass. It's recursive, so this loop stays scalar
+    float lastOutput = toneFilterOutputs[channel];
+    if (tone.isRamping())
     {
-        float* channelData = buffer.getWritePointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+        for (int sample = 0; sample < numSamples; ++sample)
         {
-            channelData[sample] = processSample(channelData[sample]);
+            lastOutput += toneAlphas[sample] * (samples[sample] - lastOutput);
+            samples[sample] = lastOutput;
         }
     }
+    else
+    {
+        for (int sample = 0; sample < numSamples; ++sample)
+        {
+            lastOutput += toneAlpha * (samples[sample] - lastOutput);
+            samples[sample] = lastOutput;
+        }
+    }
+    toneFilterOutputs[channel] = lastOutput;
+
+    // Level
+    level.applyGain(samples, numSamples);
 }
 
 void DistortionEffect::setParameter(int parameterId, float value)
@@ -36,13 +96,13 @@ void DistortionEffect::setParameter(int parameterId, float value)
     switch (parameterId)
     {
         case Drive:
-            drive = juce::jlimit(0.0f, 1.0f, value);
+            drive.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
         case Tone:
-            tone = juce::jlimit(0.0f, 1.0f, value);
+            tone.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
         case Level:
-            level = juce::jlimit(0.0f, 1.0f, value);
+            level.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
     }
 }
@@ -51,9 +111,9 @@ float DistortionEffect::getParameter(int parameterId) const
 {
     switch (parameterId)
     {
-        case Drive: return drive;
-        case Tone: return tone;
-        case Level: return level;
+        case Drive: return drive.getTargetValue();
+        case Tone: return tone.getTargetValue();
+        case Level: return level.getTargetValue();
         default: return 0.0f;
     }
 }
@@ -90,41 +150,12 @@ float DistortionEffect::getParameterMaxValue(int parameterId) const
     return 1.0f;
 }
 
-float DistortionEffect::processSample(float input)
-{
-    // Apply drive
-    float distorted = applyDrive(input);
-    
-    // Apply tone filter
-    float filtered = applyToneFilter(distorted);
-    
-    // Apply level
-    return filtered * level;
-}
-
-float DistortionEffect::applyDrive(float input)
-{
-    // Soft clipping distortion
-    float driveAmount = 1.0f + drive * 10.0f; // 1x to 11x gain
-    float driven = input * driveAmount;
-    
-    // Soft clipping using tanh approximation
-    return std::tanh(driven);
-}
-
-float DistortionEffect::applyToneFilter(float input)
+float DistortionEffect::calculateToneAlpha(float toneValue) const
 {
     // Simple low-pass filter based on tone parameter
     // Higher tone values = brighter sound (less filtering)
-    float cutoffFreq = 200.0f + tone * 8000.0f; // 200Hz to 8.2kHz
+    float cutoffFreq = 200.0f + toneValue * 8000.0f; // 200Hz to 8.2kHz
     float rc = 1.0f / (2.0f * M_PI * cutoffFreq);
     float dt = 1.0f / sampleRate;
-    float alpha = dt / (rc + dt);
-    
-    // Simple first-order low-pass filter
-    static float lastOutput = 0.0f;
-    float output = alpha * input + (1.0f - alpha) * lastOutput;
-    lastOutput = output;
-    
-    return output;
+    return dt / (rc + dt);
 } 
\ No newline at end of file
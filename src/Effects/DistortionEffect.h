@@ -1,6 +1,7 @@
 #pragma once
 
 #include "BaseEffect.h"
+#include <vector>
 
 class DistortionEffect : public BaseEffect
 {
@@ -9,11 +10,13 @@ public:
     ~DistortionEffect() override;
 
     // Setup
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels) override;
     void releaseResources() override;
 
     // Audio processing
-    void processAudio(juce::AudioBuffer<float>& buffer) override;
+    void beginBlock(int numSamples) override;
+    void processChannel(float* samples, int numSamples, int channel) override;
+    bool hasIndependentChannels() const override { return true; }
 
     // Parameter management
     void setParameter(int parameterId, float value) override;
@@ -38,14 +41,20 @@ public:
 
 private:
     // Parameters
-    float drive = 0.5f;
-    float tone = 0.5f;
-    float level = 0.5f;
+    SmoothedParameter drive { 0.5f };
+    SmoothedParameter tone { 0.5f };
+    SmoothedParameter level { 0.5f };
+
+    // Tone filter state
+    std::vector<float> toneFilterOutputs; // Last output for each channel
+    float toneAlpha = 1.0f;
+
+    // Per-block ramps shared by every channel, only filled while the parameter moves
+    std::vector<float> driveGains;
+    std::vector<float> toneAlphas;
 
     // Processing
-    float processSample(float input);
-    float applyDrive(float input);
-    float applyToneFilter(float input);
+    float calculateToneAlpha(float toneValue) const;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DistortionEffect)
 }; 
\ No newline at end of file
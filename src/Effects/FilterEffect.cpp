@@ -1,26 +1,35 @@
 #include "FilterEffect.h"
+#include "AudioUtils.h"
 #include <cmath>
 
 FilterEffect::FilterEffect()
 {
+    registerSmoothedParameters({ &cutoffFreq, &resonance, &drive });
 }
 
 FilterEffect::~FilterEffect()
 {
 }
 
-void FilterEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void FilterEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels)
 {
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
+    this->numChannels = numChannels;
 
     // Initialize filter history for each channel
-    x1.resize(2, 0.0f);
-    x2.resize(2, 0.0f);
-    y1.resize(2, 0.0f);
-    y2.resize(2, 0.0f);
+    x1.assign(numChannels, 0.0f);
+    x2.assign(numChannels, 0.0f);
+    y1.assign(numChannels, 0.0f);
+    y2.assign(numChannels, 0.0f);
 
-    updateFilterCoefficients();
+    rampCoefficients.resize((samplesPerBlockExpected + coefficientUpdateInterval - 1) / coefficientUpdateInterval);
+    driveGains.assign(samplesPerBlockExpected, 1.0f);
+    feedForward.assign(numChannels, std::vector<float>(juce::jmax(samplesPerBlockExpected, coefficientUpdateInterval), 0.0f));
+    prepareSmoothedParameters();
+
+    coefficients = calculateCoefficients(cutoffFreq.getCurrentValue(), resonance.getCurrentValue());
+    coefficientsDirty = false;
 }
 
 void FilterEffect::releaseResources()
@@ -29,17 +38,51 @@ void FilterEffect::releaseResources()
     x2.clear();
     y1.clear();
     y2.clear();
+
+    rampCoefficients.clear();
+    driveGains.clear();
+    feedForward.clear();
+    releaseSmoothedParameters();
 }
 
-void FilterEffect::processAudio(juce::AudioBuffer<float>& buffer)
+void FilterEffect::beginBlock(int numSamples)
 {
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    BaseEffect::beginBlock(numSamples);
+    updateFilterCoefficients(numSamples);
+
+    if (drive.isRamping())
     {
-        float* channelData = buffer.getWritePointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-        {
-            channelData[sample] = processSample(channelData[sample], channel);
-        }
+        juce::FloatVectorOperations::copyWithMultiply(driveGains.data(), drive.getRampValues(), 5.0f, numSamples);
+        juce::FloatVectorOperations::add(driveGains.data(), 1.0f, numSamples);
+    }
+}
+
+void FilterEffect::processChannel(float* samples, int numSamples, int channel)
+{
+    if (channel >= static_cast<int>(x1.size()))
+        return;
+
+    // Drive into a soft clipper, skipped entirely while it's off
+    if (drive.isRamping())
+    {
+        juce::FloatVectorOperations::multiply(samples, driveGains.data(), numSamples);
+        AudioUtils::softClip(samples, numSamples);
+    }
+    else if (drive.getCurrentValue() > 0.0f)
+    {
+        juce::FloatVectorOperations::multiply(samples, 1.0f + drive.getCurrentValue() * 5.0f, numSamples);
+        AudioUtils::softClip(samples, numSamples);
+    }
+
+    // Filter in runs that share one set of coefficients: an update interval
+    // while ramping, otherwise as much of the block as the scratch holds
+    const bool coefficientsRamping = cutoffFreq.isRamping() || resonance.isRamping();
+    const int runLength = coefficientsRamping ? coefficientUpdateInterval : static_cast<int>(feedForward[channel].size());
+
+    for (int start = 0; start < numSamples; start += runLength)
+    {
+        const auto& c = coefficientsRamping ? rampCoefficients[start / coefficientUpdateInterval] : coefficients;
+        filterRun(samples + start, juce::jmin(runLength, numSamples - start), channel, c);
     }
 }
 
@@ -48,19 +91,18 @@ void FilterEffect::setParameter(int parameterId, float value)
     switch (parameterId)
     {
         case Cutoff:
-            cutoffFreq = juce::jlimit(20.0f, 20000.0f, value);
-            updateFilterCoefficients();
+            cutoffFreq.setTargetValue(juce::jlimit(20.0f, 20000.0f, value));
             break;
         case Resonance:
-            resonance = juce::jlimit(0.0f, 1.0f, value);
-            updateFilterCoefficients();
+            resonance.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
         case FilterType:
-            filterType = static_cast<FilterType>(static_cast<int>(value * 3.0f));
-            updateFilterCoefficients();
+            // Discrete, so it switches at the next block rather than ramping
+            filterMode = static_cast<FilterMode>(static_cast<int>(juce::jlimit(0.0f, 1.0f, value) * 3.0f));
+            coefficientsDirty = true;
             break;
         case Drive:
-            drive = juce::jlimit(0.0f, 1.0f, value);
+            drive.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
     }
 }
@@ -69,10 +111,10 @@ float FilterEffect::getParameter(int parameterId) const
 {
     switch (parameterId)
     {
-        case Cutoff: return cutoffFreq;
-        case Resonance: return resonance;
-        case FilterType: return static_cast<float>(filterType) / 3.0f;
-        case Drive: return drive;
+        case Cutoff: return cutoffFreq.getTargetValue();
+        case Resonance: return resonance.getTargetValue();
+        case FilterType: return static_cast<float>(filterMode) / 3.0f;
+        case Drive: return drive.getTargetValue();
         default: return 0.0f;
     }
 }
@@ -125,51 +167,83 @@ float FilterEffect::getParameterMaxValue(int parameterId) const
     }
 }
 
-void FilterEffect::updateFilterCoefficients()
+void FilterEffect::updateFilterCoefficients(int numSamples)
 {
-    switch (filterType)
+    if (cutoffFreq.isRamping() || resonance.isRamping())
     {
-        case FilterType::LowPass:
-            calculateLowPassCoefficients();
-            break;
-        case FilterType::HighPass:
-            calculateHighPassCoefficients();
-            break;
-        case FilterType::BandPass:
-            calculateBandPassCoefficients();
-            break;
-        case FilterType::Notch:
-            calculateNotchCoefficients();
-            break;
+        // Sub-block rate is plenty for a 20 ms ramp, and far cheaper than per sample
+        for (int i = 0; i * coefficientUpdateInterval < numSamples; ++i)
+        {
+            const int sample = i * coefficientUpdateInterval;
+            rampCoefficients[i] = calculateCoefficients(cutoffFreq.getValue(sample), resonance.getValue(sample));
+        }
+
+        // Settle on the exact end values once the ramp is over
+        coefficientsDirty = true;
+        return;
+    }
+
+    // Static values: nothing to do unless something changed since the last block
+    if (coefficientsDirty)
+    {
+        coefficients = calculateCoefficients(cutoffFreq.getCurrentValue(), resonance.getCurrentValue());
+        coefficientsDirty = false;
     }
 }
 
-float FilterEffect::processSample(float input, int channel)
+FilterEffect::Coefficients FilterEffect::calculateCoefficients(float cutoff, float q) const
 {
-    // Apply drive
-    if (drive > 0.0f)
+    switch (filterMode)
     {
-        float driveAmount = 1.0f + drive * 5.0f;
-        input *= driveAmount;
-        input = std::tanh(input);
+        case FilterMode::LowPass: return calculateLowPassCoefficients(cutoff, q);
+        case FilterMode::HighPass: return calculateHighPassCoefficients(cutoff, q);
+        case FilterMode::BandPass: return calculateBandPassCoefficients(cutoff, q);
+        case FilterMode::Notch: return calculateNotchCoefficients(cutoff, q);
     }
 
-    // Apply filter
-    float output = a0 * input + a1 * x1[channel] + a2 * x2[channel] - b1 * y1[channel] - b2 * y2[channel];
+    return {};
+}
+
+void FilterEffect::filterRun(float* samples, int numSamples, int channel, const Coefficients& c)
+{
+    float* ff = feedForward[channel].data();
+
+    // Feed-forward half, a0 x[n] + a1 x[n-1] + a2 x[n-2], vectorised across the run
+    juce::FloatVectorOperations::copyWithMultiply(ff, samples, c.a0, numSamples);
+    if (numSamples > 1)
+        juce::FloatVectorOperations::addWithMultiply(ff + 1, samples, c.a1, numSamples - 1);
+    if (numSamples > 2)
+        juce::FloatVectorOperations::addWithMultiply(ff + 2, samples, c.a2, numSamples - 2);
 
-    // Update history
-    x2[channel] = x1[channel];
-    x1[channel] = input;
-    y2[channel] = y1[channel];
-    y1[channel] = output;
+    // The first two outputs reach back into the previous run's input
+    ff[0] += c.a1 * x1[channel] + c.a2 * x2[channel];
+    if (numSamples > 1)
+        ff[1] += c.a2 * x1[channel];
+
+    // Update input history
+    x2[channel] = numSamples > 1 ? samples[numSamples - 2] : x1[channel];
+    x1[channel] = samples[numSamples - 1];
+
+    // Feedback half is recursive, so it stays scalar
+    float out1 = y1[channel];
+    float out2 = y2[channel];
+    for (int sample = 0; sample < numSamples; ++sample)
+    {
+        const float output = ff[sample] - c.b1 * out1 - c.b2 * out2;
+        out2 = out1;
+        out1 = output;
+        samples[sample] = output;
+    }
 
-    return output;
+    // Update output history
+    y1[channel] = out1;
+    y2[channel] = out2;
 }
 
-void FilterEffect::calculateLowPassCoefficients()
+FilterEffect::Coefficients FilterEffect::calculateLowPassCoefficients(float cutoff, float q) const
 {
-    float w0 = 2.0f * M_PI * cutoffFreq / sampleRate;
-    float alpha = std::sin(w0) * resonance;
+    float w0 = 2.0f * M_PI * cutoff / sampleRate;
+    float alpha = std::sin(w0) * q;
     float cosw0 = std::cos(w0);
 
     float b0 = 1.0f + alpha;
@@ -180,17 +254,13 @@ void FilterEffect::calculateLowPassCoefficients()
     float a2 = (1.0f - cosw0) / 2.0f;
 
     // Normalize
-    this->a0 = a0 / b0;
-    this->a1 = a1 / b0;
-    this->a2 = a2 / b0;
-    this->b1 = b1 / b0;
-    this->b2 = b2 / b0;
+    return { a0 / b0, a1 / b0, a2 / b0, b1 / b0, b2 / b0 };
 }
 
-void FilterEffect::calculateHighPassCoefficients()
+FilterEffect::Coefficients FilterEffect::calculateHighPassCoefficients(float cutoff, float q) const
 {
-    float w0 = 2.0f * M_PI * cutoffFreq / sampleRate;
-    float alpha = std::sin(w0) * resonance;
+    float w0 = 2.0f * M_PI * cutoff / sampleRate;
+    float alpha = std::sin(w0) * q;
     float cosw0 = std::cos(w0);
 
     float b0 = 1.0f + alpha;
@@ -201,17 +271,13 @@ void FilterEffect::calculateHighPassCoefficients()
     float a2 = (1.0f + cosw0) / 2.0f;
 
     // Normalize
-    this->a0 = a0 / b0;
-    this->a1 = a1 / b0;
-    this->a2 = a2 / b0;
-    this->b1 = b1 / b0;
-    this->b2 = b2 / b0;
+    return { a0 / b0, a1 / b0, a2 / b0, b1 / b0, b2 / b0 };
 }
 
-void FilterEffect::calculateBandPassCoefficients()
+FilterEffect::Coefficients FilterEffect::calculateBandPassCoefficients(float cutoff, float q) const
 {
-    float w0 = 2.0f * M_PI * cutoffFreq / sampleRate;
-    float alpha = std::sin(w0) * resonance;
+    float w0 = 2.0f * M_PI * cutoff / sampleRate;
+    float alpha = std::sin(w0) * q;
     float cosw0 = std::cos(w0);
 
     float b0 = 1.0f + alpha;
@@ -222,17 +288,13 @@ void FilterEffect::calculateBandPassCoefficients()
     float a2 = -alpha;
 
     // Normalize
-    this->a0 = a0 / b0;
-    this->a1 = a1 / b0;
-    this->a2 = a2 / b0;
-    this->b1 = b1 / b0;
-    this->b2 = b2 / b0;
+    return { a0 / b0, a1 / b0, a2 / b0, b1 / b0, b2 / b0 };
 }
 
-void FilterEffect::calculateNotchCoefficients()
+FilterEffect::Coefficients FilterEffect::calculateNotchCoefficients(float cutoff, float q) const
 {
-    float w0 = 2.0f * M_PI * cutoffFreq / sampleRate;
-    float alpha = std::sin(w0) * resonance;
+    float w0 = 2.0f * M_PI * cutoff / sampleRate;
+    float alpha = std::sin(w0) * q;
     float cosw0 = std::cos(w0);
 
     float b0 = 1.0f + alpha;
@@ -243,9 +305,5 @@ void FilterEffect::calculateNotchCoefficients()
     float a2 = 1.0f;
 
     // Normalize
-    this->a0 = a0 / b0;
-    this->a1 = a1 / b0;
-    this->a2 = a2 / b0;
-    this->b1 = b1 / b0;
-    this->b2 = b2 / b0;
+    return { a0 / b0, a1 / b0, a2 / b0, b1 / b0, b2 / b0 };
 } 
\ No newline at end of file
@@ -3,7 +3,7 @@
 #include "BaseEffect.h"
 #include <vector>
 
-enum class FilterType
+enum class FilterMode
 {
     LowPass,
     HighPass,
@@ -18,11 +18,13 @@ public:
     ~FilterEffect() override;
 
     // Setup
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels) override;
     void releaseResources() override;
 
     // Audio processing
-    void processAudio(juce::AudioBuffer<float>& buffer) override;
+    void beginBlock(int numSamples) override;
+    void processChannel(float* samples, int numSamples, int channel) override;
+    bool hasIndependentChannels() const override { return true; }
 
     // Parameter management
     void setParameter(int parameterId, float value) override;
@@ -47,23 +49,38 @@ public:
     };
 
 private:
+    struct Coefficients
+    {
+        float a0 = 1.0f, a1 = 0.0f, a2 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+    };
+
+    // While cutoff or resonance ramps, coefficients are recomputed this often
+    static constexpr int coefficientUpdateInterval = 16;
+
     // Parameters
-    float cutoffFreq = 1000.0f;
-    float resonance = 0.5f;
-    FilterType filterType = FilterType::LowPass;
-    float drive = 0.0f;
+    SmoothedParameter cutoffFreq { 1000.0f, SmoothedParameter::Ramp::Exponential };
+    SmoothedParameter resonance { 0.5f };
+    FilterMode filterMode = FilterMode::LowPass;
+    SmoothedParameter drive { 0.0f };
 
     // Filter state
     std::vector<float> x1, x2, y1, y2; // Filter history for each channel
-    float a0, a1, a2, b1, b2; // Filter coefficients
+    Coefficients coefficients;                 // For the current, static values
+    std::vector<Coefficients> rampCoefficients; // One set per update interval of a ramping block
+    bool coefficientsDirty = true;
+
+    // Block scratch
+    std::vector<float> driveGains;  // Per-sample drive while it ramps
+    std::vector<std::vector<float>> feedForward; // Feed-forward half of the biquad for one run, per channel
 
     // Processing
-    void updateFilterCoefficients();
-    float processSample(float input, int channel);
-    void calculateLowPassCoefficients();
-    void calculateHighPassCoefficients();
-    void calculateBandPassCoefficients();
-    void calculateNotchCoefficients();
+    void updateFilterCoefficients(int numSamples);
+    Coefficients calculateCoefficients(float cutoff, float q) const;
+    void filterRun(float* samples, int numSamples, int channel, const Coefficients& c);
+    Coefficients calculateLowPassCoefficients(float cutoff, float q) const;
+    Coefficients calculateHighPassCoefficients(float cutoff, float q) const;
+    Coefficients calculateBandPassCoefficients(float cutoff, float q) const;
+    Coefficients calculateNotchCoefficients(float cutoff, float q) const;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterEffect)
 }; 
\ No newline at end of file
@@ -5,17 +5,21 @@ ReverbEffect::ReverbEffect()
 {
     // Initialize delay line lengths (prime numbers for better diffusion)
     delayLengths = { 1116, 1188, 1277, 1356, 1422, 1492, 1557, 1617 };
+
+    registerSmoothedParameters({ &roomSize, &damping, &wetLevel, &dryLevel });
 }
 
 ReverbEffect::~ReverbEffect()
 {
 }
 
-void ReverbEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+void ReverbEffect::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels)
 {
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
+    this->numChannels = numChannels;
     
+    prepareSmoothedParameters();
     initializeDelayLines();
 }
 
@@ -23,22 +27,60 @@ void ReverbEffect::releaseResources()
 {
     delayLines.clear();
     delayLineIndices.clear();
-    delayLineCoeffs.clear();
+    delayLineTaps.clear();
+
+    releaseSmoothedParameters();
 }
 
-void ReverbEffect::processAudio(juce::AudioBuffer<float>& buffer)
+void ReverbEffect::beginBlock(int numSamples)
 {
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    BaseEffect::beginBlock(numSamples);
+
+    // Line lengths follow the room size per sample only while it's moving
+    if (!roomSize.isRamping())
+        updateDelayLineTaps(roomSize.getCurrentValue());
+}
+
+void ReverbEffect::processChannel(float* samples, int numSamples, int channel)
+{
+    if (delayLines.empty())
+        return;
+
+    const bool roomSizeRamping = roomSize.isRamping();
+    const size_t numLines = delayLines.size();
+    const float lineCount = static_cast<float>(numLines);
+
+    for (int sample = 0; sample < numSamples; ++sample)
     {
-        float* channelData = buffer.getWritePointer(channel);
-        for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+        if (roomSizeRamping)
+            updateDelayLineTaps(roomSize.getValue(sample));
+
+        // Feedback coefficient based on damping, 0.3 to 0.6
+        const float input = samples[sample];
+        const float feedbackCoeff = 0.6f - damping.getValue(sample) * 0.3f;
+
+        // Each line feeds back on itself; the output averages their taps
+        float processed = 0.0f;
+        for (size_t i = 0; i < numLines; ++i)
         {
-            float input = channelData[sample];
-            float processed = processSample(input, channel);
-            
-            // Mix dry and wet signals
-            channelData[sample] = input * dryLevel + processed * wetLevel;
+            float* line = delayLines[i].data();
+            const int length = static_cast<int>(delayLines[i].size());
+            const int writeIndex = delayLineIndices[i];
+
+            // Get delayed sample, one line length behind the write position
+            int readIndex = writeIndex - delayLineTaps[i];
+            if (readIndex < 0)
+                readIndex += length;
+            const float delayed = line[readIndex];
+
+            processed += delayed;
+            line[writeIndex] = input + delayed * feedbackCoeff;
+            delayLineIndices[i] = writeIndex + 1 < length ? writeIndex + 1 : 0;
         }
+        processed /= lineCount;
+        
+        // Mix dry and wet signals
+        samples[sample] = input * dryLevel.getValue(sample) + processed * wetLevel.getValue(sample);
     }
 }
 
@@ -47,16 +89,16 @@ void ReverbEffect::setParameter(int parameterId, float value)
     switch (parameterId)
     {
         case RoomSize:
-            roomSize = juce::jlimit(0.0f, 1.0f, value);
+            roomSize.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
         case Damping:
-            damping = juce::jlimit(0.0f, 1.0f, value);
+            damping.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
         case WetLevel:
-            wetLevel = juce::jlimit(0.0f, 1.0f, value);
+            wetLevel.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
         case DryLevel:
-            dryLevel = juce::jlimit(0.0f, 1.0f, value);
+            dryLevel.setTargetValue(juce::jlimit(0.0f, 1.0f, value));
             break;
     }
 }
@@ -65,10 +107,10 @@ float ReverbEffect::getParameter(int parameterId) const
 {
     switch (parameterId)
     {
-        case RoomSize: return roomSize;
-        case Damping: return damping;
-        case WetLevel: return wetLevel;
-        case DryLevel: return dryLevel;
+        case RoomSize: return roomSize.getTargetValue();
+        case Damping: return damping.getTargetValue();
+        case WetLevel: return wetLevel.getTargetValue();
+        case DryLevel: return dryLevel.getTargetValue();
         default: return 0.0f;
     }
 }
@@ -112,46 +154,24 @@ void ReverbEffect::initializeDelayLines()
     int numDelayLines = delayLengths.size();
     delayLines.resize(numDelayLines);
     delayLineIndices.resize(numDelayLines);
-    delayLineCoeffs.resize(numDelayLines);
-    
-    // Scale delay lengths based on room size
-    float sizeMultiplier = 0.5f + roomSize * 2.0f;
+    delayLineTaps.resize(numDelayLines);
     
+    // Allocate for the largest room (size multiplier 2.5)
     for (int i = 0; i < numDelayLines; ++i)
     {
-        int scaledLength = static_cast<int>(delayLengths[i] * sizeMultiplier);
-        delayLines[i].resize(scaledLength);
-        std::fill(delayLines[i].begin(), delayLines[i].end(), 0.0f);
+        int maxLength = static_cast<int>(delayLengths[i] * 2.5f) + 1;
+        delayLines[i].assign(maxLength, 0.0f);
         delayLineIndices[i] = 0;
-        
-        // Set feedback coefficient based on damping
-        delayLineCoeffs[i] = 0.6f - damping * 0.3f; // 0.3 to 0.6
     }
+
+    updateDelayLineTaps(roomSize.getCurrentValue());
 }
 
-float ReverbEffect::processSample(float input, int channel)
+void ReverbEffect::updateDelayLineTaps(float roomSizeValue)
 {
-    float output = 0.0f;
-    
-    // Process through all delay lines
-    for (size_t i = 0; i < delayLines.size(); ++i)
-    {
-        // Get delayed sample
-        float delayed = delayLines[i][delayLineIndices[i]];
-        
-        // Add to output
-        output += delayed;
-        
-        // Update delay line
-        float feedback = input + delayed * delayLineCoeffs[i];
-        delayLines[i][delayLineIndices[i]] = feedback;
-        
-        // Update index
-        delayLineIndices[i] = (delayLineIndices[i] + 1) % delayLines[i].size();
-    }
-    
-    // Normalize output
-    output /= static_cast<float>(delayLines.size());
-    
-    return output;
-} 
\ No newline at end of file
+    // Scale delay lengths based on room size
+    float sizeMultiplier = 0.5f + roomSizeValue * 2.0f;
+
+    for (size_t i = 0; i < delayLineTaps.size(); ++i)
+        delayLineTaps[i] = static_cast<int>(delayLengths[i] * sizeMultiplier);
+}
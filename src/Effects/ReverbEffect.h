@@ -10,11 +10,12 @@ public:
     ~ReverbEffect() override;
 
     // Setup
-    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int numChannels) override;
     void releaseResources() override;
 
     // Audio processing
-    void processAudio(juce::AudioBuffer<float>& buffer) override;
+    void beginBlock(int numSamples) override;
+    void processChannel(float* samples, int numSamples, int channel) override;
 
     // Parameter management
     void setParameter(int parameterId, float value) override;
@@ -40,22 +41,22 @@ public:
 
 private:
     // Parameters
-    float roomSize = 0.5f;
-    float damping = 0.5f;
-    float wetLevel = 0.3f;
-    float dryLevel = 0.7f;
+    SmoothedParameter roomSize { 0.5f };
+    SmoothedParameter damping { 0.5f };
+    SmoothedParameter wetLevel { 0.3f };
+    SmoothedParameter dryLevel { 0.7f };
 
-    // Reverb buffers
+    // Reverb buffers, sized for the largest room so room size changes never reallocate
     std::vector<std::vector<float>> delayLines;
     std::vector<int> delayLineIndices;
-    std::vector<float> delayLineCoeffs;
+    std::vector<int> delayLineTaps; // Current length of each line for the room size
     
     // Delay line lengths (in samples)
     std::vector<int> delayLengths;
 
     // Processing
     void initializeDelayLines();
-    float processSample(float input, int channel);
+    void updateDelayLineTaps(float roomSizeValue);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReverbEffect)
 }; 
\ No newline at end of file
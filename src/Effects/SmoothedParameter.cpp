@@ -0,0 +1,102 @@
+#include "SmoothedParameter.h"
+#include <cmath>
+
+SmoothedParameter::SmoothedParameter(float initialValue, Ramp ramp, double rampSeconds)
+    : ramp(ramp), rampSeconds(rampSeconds), current(initialValue), target(initialValue)
+{
+}
+
+SmoothedParameter::~SmoothedParameter()
+{
+}
+
+void SmoothedParameter::prepare(double sampleRate, int maxBlockSize)
+{
+    rampLengthSamples = juce::jmax(0, static_cast<int>(rampSeconds * sampleRate));
+    rampValues.assign(static_cast<size_t>(juce::jmax(0, maxBlockSize)), 0.0f);
+    reset();
+}
+
+void SmoothedParameter::release()
+{
+    reset();
+    rampValues.clear();
+    rampValues.shrink_to_fit();
+}
+
+void SmoothedParameter::setTargetValue(float newValue)
+{
+    if (newValue == target)
+        return;
+
+    target = newValue;
+
+    // Unprepared, or an exponential ramp through zero, which it can't do
+    const bool canRamp = rampLengthSamples > 0
+                      && (ramp == Ramp::Linear || (current > 0.0f && target > 0.0f));
+    jassert(ramp == Ramp::Linear || target > 0.0f);
+
+    if (!canRamp)
+    {
+        reset();
+        return;
+    }
+
+    samplesRemaining = rampLengthSamples;
+    step = ramp == Ramp::Linear ? (target - current) / static_cast<float>(rampLengthSamples)
+                                : static_cast<float>(std::pow(static_cast<double>(target) / current, 1.0 / rampLengthSamples));
+}
+
+void SmoothedParameter::setCurrentAndTargetValue(float newValue)
+{
+    target = newValue;
+    reset();
+}
+
+void SmoothedParameter::reset()
+{
+    current = target;
+    samplesRemaining = 0;
+    rampingThisBlock = false;
+}
+
+void SmoothedParameter::advance(int numSamples)
+{
+    if (samplesRemaining == 0)
+    {
+        rampingThisBlock = false;
+        return;
+    }
+
+    // Larger than prepared for: no room for the ramp, so land on the target
+    if (numSamples > static_cast<int>(rampValues.size()))
+    {
+        jassertfalse;
+        reset();
+        return;
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (samplesRemaining > 0)
+        {
+            current = ramp == Ramp::Linear ? current + step : current * step;
+
+            // Land exactly, whatever rounding crept in
+            if (--samplesRemaining == 0)
+                current = target;
+        }
+
+        rampValues[static_cast<size_t>(i)] = current;
+    }
+
+    rampingThisBlock = true;
+}
+
+void SmoothedParameter::applyGain(float* samples, int numSamples, int startSample) const
+{
+    if (rampingThisBlock)
+        juce::FloatVectorOperations::multiply(samples, rampValues.data() + startSample, numSamples);
+    else if (current != 1.0f)
+        juce::FloatVectorOperations::multiply(samples, current, numSamples);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <vector>
+
+// An effect parameter that glides to new values instead of jumping. Setting a
+// value only moves the target; once per block the audio thread advances the
+// parameter, which precomputes that block's ramp into a buffer sized in
+// prepare(). While the value is static nothing is computed and the effect can
+// take its block-rate path, so smoothing costs nothing unless automation is
+// actually moving.
+class SmoothedParameter
+{
+public:
+    enum class Ramp
+    {
+        Linear,      // Constant step; gains, mixes, times
+        Exponential  // Constant ratio; frequencies and other values heard on a log scale (must stay > 0)
+    };
+
+    explicit SmoothedParameter(float initialValue = 0.0f, Ramp ramp = Ramp::Linear, double rampSeconds = 0.02);
+    ~SmoothedParameter();
+
+    // Setup (allocates the ramp buffer)
+    void prepare(double sampleRate, int maxBlockSize);
+    void release();
+
+    // Value
+    void setTargetValue(float newValue);
+    void setCurrentAndTargetValue(float newValue); // Jumps, no ramp
+    void reset();                                   // Jumps to the target
+    float getTargetValue() const { return target; }
+    float getCurrentValue() const { return current; }
+
+    // Audio thread, once per block before reading it
+    void advance(int numSamples);
+
+    // The block just advanced
+    bool isRamping() const { return rampingThisBlock; }
+    float getValue(int sample) const { return rampingThisBlock ? rampValues[static_cast<size_t>(sample)] : current; }
+    const float* getRampValues() const { return rampValues.data(); } // Only meaningful while ramping
+    void applyGain(float* samples, int numSamples, int startSample = 0) const; // Multiplies by the block's values
+
+private:
+    Ramp ramp;
+    double rampSeconds;
+    int rampLengthSamples = 0;
+
+    float current;
+    float target;
+    float step = 0.0f;          // Added (linear) or multiplied (exponential) per sample
+    int samplesRemaining = 0;
+    bool rampingThisBlock = false;
+
+    std::vector<float> rampValues;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SmoothedParameter)
+};
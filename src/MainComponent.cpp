@@ -35,6 +35,7 @@ void MainComponent::resized()
     // Control area
     auto controlArea = bounds.removeFromTop(80);
     startStopButton.setBounds(controlArea.removeFromLeft(120).reduced(10));
+    channelLayoutComboBox.setBounds(controlArea.removeFromLeft(200).removeFromTop(40).reduced(10, 5));
     
     auto gainArea = controlArea.removeFromRight(300);
     inputGainSlider.setBounds(gainArea.removeFromTop(35).reduced(10));
@@ -61,6 +62,9 @@ void MainComponent::setupAudio()
     setup.sampleRate = 44100.0;
     setup.bufferSize = 256;
     deviceManager->setAudioDeviceSetup(setup, true);
+    
+    // Lanes follow the inputs the device actually has
+    updateInputChannels();
 }
 
 void MainComponent::setupUI()
@@ -69,11 +73,13 @@ void MainComponent::setupUI()
     triggerPanel = std::make_unique<TriggerPanel>(audioProcessor.get());
     effectPanel = std::make_unique<EffectPanel>(audioProcessor.get());
     audioSettingsPanel = std::make_unique<AudioSettingsPanel>(deviceManager.get());
+    diagnosticsPanel = std::make_unique<DiagnosticsPanel>(audioProcessor.get(), deviceManager.get());
     
     // Setup tabbed component
     tabbedComponent.addTab("Triggers", juce::Colour(0xff2d2d2d), triggerPanel.get(), false);
     tabbedComponent.addTab("Effects", juce::Colour(0xff2d2d2d), effectPanel.get(), false);
     tabbedComponent.addTab("Audio Settings", juce::Colour(0xff2d2d2d), audioSettingsPanel.get(), false);
+    tabbedComponent.addTab("Diagnostics", juce::Colour(0xff2d2d2d), diagnosticsPanel.get(), false);
     addAndMakeVisible(tabbedComponent);
     
     // Setup start/stop button
@@ -86,6 +92,18 @@ void MainComponent::setupUI()
     };
     addAndMakeVisible(startStopButton);
     
+    // Setup channel layout
+    channelLayoutComboBox.addItem("Linked inputs", 1);
+    channelLayoutComboBox.addItem("Lane per input", 2);
+    channelLayoutComboBox.setSelectedId(audioProcessor->getChannelLayout() == ChannelLayout::Linked ? 1 : 2,
+                                        juce::dontSendNotification);
+    channelLayoutComboBox.onChange = [this]() {
+        audioProcessor->setChannelLayout(channelLayoutComboBox.getSelectedId() == 1 ? ChannelLayout::Linked
+                                                                                     : ChannelLayout::PerInput);
+        applyChannelLayout();
+    };
+    addAndMakeVisible(channelLayoutComboBox);
+    
     // Setup status label
     statusLabel.setText("Ready", juce::dontSendNotification);
     statusLabel.setColour(juce::Label::textColourId, juce::Colours::lightgreen);
@@ -149,6 +167,34 @@ void MainComponent::updateStatus()
     }
 }
 
+void MainComponent::updateInputChannels()
+{
+    auto* device = deviceManager->getCurrentAudioDevice();
+    if (device == nullptr)
+        return;
+    
+    const int numInputs = device->getActiveInputChannels().countNumberOfSetBits();
+    if (numInputs > 0 && numInputs != audioProcessor->getNumInputChannels())
+    {
+        audioProcessor->setNumInputChannels(numInputs);
+        applyChannelLayout();
+    }
+}
+
+void MainComponent::applyChannelLayout()
+{
+    // Lanes are laid out when the processor is prepared, so swap it out and
+    // back in; the player releases and re-prepares it at the device's settings.
+    // Every lane's triggers and effects survive the round trip.
+    audioSourcePlayer->setSource(nullptr);
+    audioSourcePlayer->setSource(audioProcessor.get());
+    
+    if (triggerPanel)
+        triggerPanel->updateLanes();
+    if (effectPanel)
+        effectPanel->updateLanes();
+}
+
 void MainComponent::audioDeviceListChanged()
 {
     // Handle audio device list changes
@@ -157,5 +203,6 @@ void MainComponent::audioDeviceListChanged()
 void MainComponent::audioDeviceSetupChanged()
 {
     // Handle audio device setup changes
+    updateInputChannels();
     updateStatus();
 } 
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "UI/TriggerPanel.h"
 #include "UI/EffectPanel.h"
 #include "UI/AudioSettingsPanel.h"
+#include "UI/DiagnosticsPanel.h"
 
 class MainComponent : public juce::Component,
                      public juce::AudioDeviceManager::Listener
@@ -31,10 +32,12 @@ private:
     std::unique_ptr<TriggerPanel> triggerPanel;
     std::unique_ptr<EffectPanel> effectPanel;
     std::unique_ptr<AudioSettingsPanel> audioSettingsPanel;
+    std::unique_ptr<DiagnosticsPanel> diagnosticsPanel;
     
     // UI elements
     juce::TabbedComponent tabbedComponent;
     juce::TextButton startStopButton;
+    juce::ComboBox channelLayoutComboBox;
     juce::Label statusLabel;
     juce::Slider inputGainSlider;
     juce::Slider outputGainSlider;
@@ -48,6 +51,8 @@ private:
     void startAudio();
     void stopAudio();
     void updateStatus();
+    void updateInputChannels();
+    void applyChannelLayout();
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 }; 
\ No newline at end of file
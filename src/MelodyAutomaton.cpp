@@ -0,0 +1,132 @@
+#include "MelodyAutomaton.h"
+#include <algorithm>
+
+MelodyAutomaton::MelodyAutomaton()
+{
+    clear();
+}
+
+MelodyAutomaton::~MelodyAutomaton()
+{
+}
+
+void MelodyAutomaton::clear()
+{
+    numStates = 1;
+    currentState = 0;
+    transitions.assign(alphabetSize, 0);
+    outputStart.assign(2, 0);
+    outputs.clear();
+}
+
+void MelodyAutomaton::compile(const std::vector<std::vector<int>>& patterns)
+{
+    // Build the trie; -1 marks a missing edge until failure links fill it in
+    std::vector<int> trie(alphabetSize, -1);
+    std::vector<std::vector<int>> stateOutputs(1);
+
+    for (int pattern = 0; pattern < static_cast<int>(patterns.size()); ++pattern)
+    {
+        if (patterns[pattern].empty())
+            continue;
+
+        int state = 0;
+        for (int note : patterns[pattern])
+        {
+            note = juce::jlimit(0, alphabetSize - 1, note);
+            int& next = trie[state * alphabetSize + note];
+
+            if (next < 0)
+            {
+                next = static_cast<int>(stateOutputs.size());
+                stateOutputs.emplace_back();
+                trie.resize(trie.size() + alphabetSize, -1);
+            }
+
+            state = trie[state * alphabetSize + note];
+        }
+
+        stateOutputs[state].push_back(pattern);
+    }
+
+    const int newNumStates = static_cast<int>(stateOutputs.size());
+    std::vector<int> failure(newNumStates, 0);
+    std::vector<int> queue;
+    queue.reserve(newNumStates);
+
+    // Root edges: missing ones loop back to the root
+    for (int note = 0; note < alphabetSize; ++note)
+    {
+        int& next = trie[note];
+        if (next < 0)
+        {
+            next = 0;
+        }
+        else
+        {
+            failure[next] = 0;
+            queue.push_back(next);
+        }
+    }
+
+    // Breadth-first: each missing edge copies its failure state's edge, and each
+    // state inherits the outputs of its failure state
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+        const int state = queue[head];
+        const auto& inherited = stateOutputs[failure[state]];
+        stateOutputs[state].insert(stateOutputs[state].end(), inherited.begin(), inherited.end());
+
+        for (int note = 0; note < alphabetSize; ++note)
+        {
+            int& next = trie[state * alphabetSize + note];
+            const int fallback = trie[failure[state] * alphabetSize + note];
+
+            if (next < 0)
+            {
+                next = fallback;
+            }
+            else
+            {
+                failure[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    // Flatten the outputs
+    outputStart.assign(newNumStates + 1, 0);
+    outputs.clear();
+    for (int state = 0; state < newNumStates; ++state)
+    {
+        outputStart[state] = static_cast<int>(outputs.size());
+        outputs.insert(outputs.end(), stateOutputs[state].begin(), stateOutputs[state].end());
+    }
+    outputStart[newNumStates] = static_cast<int>(outputs.size());
+
+    transitions = std::move(trie);
+    numStates = newNumStates;
+    currentState = 0;
+}
+
+int MelodyAutomaton::advance(int note)
+{
+    if (note < 0 || note >= alphabetSize)
+    {
+        currentState = 0;
+        return 0;
+    }
+
+    currentState = transitions[currentState * alphabetSize + note];
+    return getNumMatches();
+}
+
+const int* MelodyAutomaton::getMatches() const
+{
+    return outputs.data() + outputStart[currentState];
+}
+
+int MelodyAutomaton::getNumMatches() const
+{
+    return outputStart[currentState + 1] - outputStart[currentState];
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// Aho-Corasick automaton over MIDI note numbers. All melody patterns are
+// compiled into one dense transition table with the failure links already
+// folded in, so advancing by a note is a single table read regardless of how
+// many patterns there are. Each state lists every pattern ending there.
+class MelodyAutomaton
+{
+public:
+    MelodyAutomaton();
+    ~MelodyAutomaton();
+
+    // Compilation (allocates; not for the audio thread)
+    void compile(const std::vector<std::vector<int>>& patterns);
+    void clear();
+
+    // Matching (real-time safe)
+    void reset() { currentState = 0; }
+    int advance(int note);                            // Returns the number of patterns ending here
+    const int* getMatches() const;                    // Pattern indices for the current state
+    int getNumMatches() const;
+
+    int getNumStates() const { return numStates; }
+
+    static constexpr int alphabetSize = 128;
+
+private:
+    int numStates = 1;
+    int currentState = 0;
+
+    std::vector<int> transitions;     // numStates * alphabetSize
+    std::vector<int> outputStart;     // numStates + 1 offsets into outputs
+    std::vector<int> outputs;         // Pattern indices, grouped by state
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MelodyAutomaton)
+};
@@ -0,0 +1,123 @@
+#include "MelodyDetector.h"
+#include <cmath>
+#include <algorithm>
+
+MelodyDetector::MelodyDetector()
+{
+    events.resize(eventHistorySize);
+}
+
+MelodyDetector::~MelodyDetector()
+{
+}
+
+void MelodyDetector::prepareToPlay(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void MelodyDetector::releaseResources()
+{
+    reset();
+}
+
+void MelodyDetector::reset()
+{
+    currentNote = -1;
+    candidateNote = -1;
+    candidateHasOnset = false;
+    candidateEmitted = false;
+    candidateStart = 0;
+    lastPitchedPosition = 0;
+    candidateLevel = 0.0f;
+    previousRms = 0.0f;
+
+    std::fill(events.begin(), events.end(), NoteEvent());
+    eventWriteIndex = 0;
+    numEvents = 0;
+}
+
+bool MelodyDetector::processFrame(float pitch, float rms, juce::int64 position)
+{
+    const bool onset = previousRms > 0.0f && rms > previousRms * onsetThreshold;
+    previousRms = rms;
+
+    if (pitch <= 0.0f)
+    {
+        candidateNote = -1;
+
+        if (currentNote >= 0 && position - lastPitchedPosition >= millisecondsToSamples(releaseTimeMs))
+            currentNote = -1;
+
+        return false;
+    }
+
+    lastPitchedPosition = position;
+    const int note = juce::jlimit(0, 127, static_cast<int>(std::round(pitch)));
+
+    // A new pitch or a fresh attack restarts the debounce
+    if (note != candidateNote || onset)
+    {
+        candidateNote = note;
+        candidateStart = position;
+        candidateHasOnset = onset || currentNote < 0;
+        candidateEmitted = false;
+        candidateLevel = rms;
+    }
+
+    if (candidateEmitted || position - candidateStart < millisecondsToSamples(minNoteDurationMs))
+        return false;
+
+    candidateEmitted = true;
+
+    // Holding the sounding note without a new attack is not a new event
+    if (candidateNote == currentNote && !candidateHasOnset)
+        return false;
+
+    currentNote = candidateNote;
+    pushEvent(candidateNote, candidateStart, candidateLevel);
+    return true;
+}
+
+const NoteEvent& MelodyDetector::getEvent(int indexFromNewest) const
+{
+    const int index = (eventWriteIndex - 1 - indexFromNewest + 2 * eventHistorySize) % eventHistorySize;
+    return events[index];
+}
+
+int MelodyDetector::getNumStoredEvents() const
+{
+    return static_cast<int>(std::min<juce::uint32>(numEvents, eventHistorySize));
+}
+
+void MelodyDetector::setMinNoteDuration(float milliseconds)
+{
+    minNoteDurationMs = juce::jlimit(0.0f, 500.0f, milliseconds);
+}
+
+void MelodyDetector::setReleaseTime(float milliseconds)
+{
+    releaseTimeMs = juce::jlimit(0.0f, 1000.0f, milliseconds);
+}
+
+void MelodyDetector::setOnsetThreshold(float levelRatio)
+{
+    onsetThreshold = juce::jlimit(1.05f, 10.0f, levelRatio);
+}
+
+void MelodyDetector::pushEvent(int note, juce::int64 position, float level)
+{
+    auto& event = events[eventWriteIndex];
+    event.note = note;
+    event.onsetSample = position;
+    event.level = level;
+
+    eventWriteIndex = (eventWriteIndex + 1) % eventHistorySize;
+    ++numEvents;
+}
+
+juce::int64 MelodyDetector::millisecondsToSamples(float milliseconds) const
+{
+    return static_cast<juce::int64>(milliseconds * 0.001 * sampleRate);
+}
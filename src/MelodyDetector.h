@@ -0,0 +1,70 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <vector>
+
+struct NoteEvent
+{
+    int note = -1;              // MIDI note number
+    juce::int64 onsetSample = 0;
+    float level = 0.0f;         // RMS at the onset
+};
+
+// Turns the per-hop pitch track into discrete note events. A note starts once
+// a pitch has held for the minimum duration, either because it differs from the
+// sounding note or because a level jump re-articulated the same note, and ends
+// after the pitch has been gone for the release time.
+class MelodyDetector
+{
+public:
+    MelodyDetector();
+    ~MelodyDetector();
+
+    // Setup
+    void prepareToPlay(double sampleRate);
+    void releaseResources();
+    void reset();
+
+    // Segmentation (real-time safe); returns true if a new note event started
+    bool processFrame(float pitch, float rms, juce::int64 position);
+
+    // Note events
+    int getCurrentNote() const { return currentNote; }                  // -1 between notes
+    juce::uint32 getNumEvents() const { return numEvents; }             // Total since reset, wraps
+    const NoteEvent& getEvent(int indexFromNewest) const;               // 0 is the newest
+    int getNumStoredEvents() const;
+
+    // Settings
+    void setMinNoteDuration(float milliseconds);
+    void setReleaseTime(float milliseconds);
+    void setOnsetThreshold(float levelRatio);
+
+private:
+    // Analysis parameters
+    double sampleRate = 44100.0;
+    float minNoteDurationMs = 20.0f;
+    float releaseTimeMs = 40.0f;
+    float onsetThreshold = 1.5f;    // RMS ratio between frames that counts as a new attack
+
+    // Segmentation state
+    int currentNote = -1;
+    int candidateNote = -1;
+    bool candidateHasOnset = false;
+    bool candidateEmitted = false;
+    juce::int64 candidateStart = 0;
+    juce::int64 lastPitchedPosition = 0;
+    float candidateLevel = 0.0f;
+    float previousRms = 0.0f;
+
+    // Event history
+    static constexpr int eventHistorySize = 32;
+    std::vector<NoteEvent> events;
+    int eventWriteIndex = 0;
+    juce::uint32 numEvents = 0;
+
+    // Helper methods
+    void pushEvent(int note, juce::int64 position, float level);
+    juce::int64 millisecondsToSamples(float milliseconds) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MelodyDetector)
+};
@@ -0,0 +1,189 @@
+#include "MelodyMatcher.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    constexpr float unreachable = std::numeric_limits<float>::infinity();
+    constexpr int numSteps = 3; // The DP looks back two input intervals
+}
+
+MelodyMatcher::MelodyMatcher()
+{
+}
+
+MelodyMatcher::~MelodyMatcher()
+{
+}
+
+void MelodyMatcher::compile(const std::vector<std::vector<int>>& newPatterns)
+{
+    patternNotes = newPatterns;
+    patterns.assign(patternNotes.size(), Pattern());
+    intervals.clear();
+    intervalOffsets.assign(patternNotes.size(), 0);
+
+    int rowSize = 0;
+    for (size_t i = 0; i < patternNotes.size(); ++i)
+    {
+        const auto& notes = patternNotes[i];
+        auto& pattern = patterns[i];
+
+        intervalOffsets[i] = static_cast<int>(intervals.size());
+        for (size_t n = 1; n < notes.size(); ++n)
+            intervals.push_back(notes[n] - notes[n - 1]);
+
+        // An edit has to leave at least two intervals to compare, or any
+        // two-note phrase would match a three-note pattern
+        pattern.numIntervals = juce::jmax(0, static_cast<int>(notes.size()) - 1);
+        pattern.maxEdits = pattern.numIntervals >= 3 ? juce::jmin(maxEdits, pattern.numIntervals - 2) : 0;
+        pattern.rowOffset = rowSize;
+
+        rowSize += numSteps * (pattern.maxEdits + 1) * (pattern.numIntervals + 1);
+    }
+
+    rows.assign(rowSize, unreachable);
+    matches.assign(patterns.size(), 0);
+    matchCosts.assign(patterns.size(), 0.0f);
+
+    reset();
+}
+
+void MelodyMatcher::setMaxEdits(int edits)
+{
+    maxEdits = juce::jlimit(0, 2, edits);
+    compile(std::vector<std::vector<int>>(patternNotes));
+}
+
+void MelodyMatcher::reset()
+{
+    std::fill(rows.begin(), rows.end(), unreachable);
+    currentStep = 0;
+    previousNote = -1;
+    previousInterval = 0;
+    numNotes = 0;
+    numMatches = 0;
+
+    for (auto& pattern : patterns)
+        pattern.lastMatchNote = -2;
+}
+
+int MelodyMatcher::processNote(int note)
+{
+    numMatches = 0;
+
+    if (previousNote < 0)
+    {
+        // The first note only anchors the intervals: every pattern may start
+        // here, or start at its second note if it tolerates an edit
+        for (const auto& pattern : patterns)
+        {
+            getRow(pattern, currentStep, 0)[0] = 0.0f;
+            if (pattern.maxEdits > 0)
+                getRow(pattern, currentStep, 1)[1] = 0.0f;
+        }
+    }
+    else
+    {
+        const int interval = note - previousNote;
+
+        for (int i = 0; i < static_cast<int>(patterns.size()); ++i)
+        {
+            float cost = 0.0f;
+            if (advancePattern(i, interval, cost))
+            {
+                matches[numMatches] = i;
+                matchCosts[numMatches] = cost;
+                ++numMatches;
+            }
+        }
+
+        previousInterval = interval;
+    }
+
+    previousNote = note;
+    currentStep = (currentStep + 1) % numSteps;
+    ++numNotes;
+
+    return numMatches;
+}
+
+void MelodyMatcher::setMaxCost(float semitones)
+{
+    maxCost = juce::jlimit(0.0f, 12.0f, semitones);
+}
+
+void MelodyMatcher::setEditPenalty(float semitones)
+{
+    editPenalty = juce::jlimit(0.0f, 12.0f, semitones);
+}
+
+float* MelodyMatcher::getRow(const Pattern& pattern, int step, int edits)
+{
+    const int rowLength = pattern.numIntervals + 1;
+    return rows.data() + pattern.rowOffset + (step * (pattern.maxEdits + 1) + edits) * rowLength;
+}
+
+bool MelodyMatcher::advancePattern(int patternIndex, int interval, float& cost)
+{
+    auto& pattern = patterns[patternIndex];
+    const int numIntervals = pattern.numIntervals;
+
+    if (numIntervals == 0)
+        return false;
+
+    const int* target = intervals.data() + intervalOffsets[patternIndex];
+    const int previousStep = (currentStep + numSteps - 1) % numSteps;
+    const int stepBeforeThat = (currentStep + numSteps - 2) % numSteps;
+
+    // row[j] = cheapest alignment of a suffix of the input, ending with this
+    // interval, against the first j pattern intervals
+    for (int edits = 0; edits <= pattern.maxEdits; ++edits)
+    {
+        float* row = getRow(pattern, currentStep, edits);
+        const float* previous = getRow(pattern, previousStep, edits);
+        const float* previousWithFewerEdits = edits > 0 ? getRow(pattern, previousStep, edits - 1) : nullptr;
+        const float* earlierWithFewerEdits = edits > 0 ? getRow(pattern, stepBeforeThat, edits - 1) : nullptr;
+
+        row[0] = edits == 0 ? 0.0f : unreachable;
+
+        for (int j = 1; j <= numIntervals; ++j)
+        {
+            const int expected = target[j - 1];
+            float best = previous[j - 1] + std::abs(interval - expected);
+
+            if (edits > 0)
+            {
+                // An extra note was played: the last two input intervals span one pattern interval
+                best = juce::jmin(best, earlierWithFewerEdits[j - 1] + std::abs(previousInterval + interval - expected));
+
+                // A note was dropped: this input interval spans two pattern intervals
+                if (j >= 2)
+                    best = juce::jmin(best, previousWithFewerEdits[j - 2] + std::abs(interval - target[j - 2] - expected));
+
+                // The pattern's first note was dropped, so the match starts here at p2
+                if (j == 1 && edits == 1)
+                    best = 0.0f;
+            }
+
+            row[j] = best;
+        }
+    }
+
+    // A missing final note can't be told apart from an unfinished phrase, so
+    // only complete alignments count
+    float bestCost = unreachable;
+    for (int edits = 0; edits <= pattern.maxEdits; ++edits)
+        bestCost = juce::jmin(bestCost, getRow(pattern, currentStep, edits)[numIntervals] + edits * editPenalty);
+
+    if (bestCost > maxCost)
+        return false;
+
+    // A match that is still holding from the previous note is the same match
+    const bool isNewMatch = pattern.lastMatchNote != numNotes - 1;
+    pattern.lastMatchNote = numNotes;
+    cost = bestCost;
+
+    return isNewMatch;
+}
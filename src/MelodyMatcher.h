@@ -0,0 +1,72 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// Fuzzy melody matching on the note-event stream. Patterns and input are
+// compared as successive intervals, so any transposition matches, and rhythm is
+// ignored, so tempo drift doesn't matter. Each pattern keeps an online
+// subsequence DTW whose rows are layered by the number of edits used: an extra
+// played note merges two input intervals, a dropped note merges two pattern
+// intervals. Limiting the edits bands the alignment, so the cost per note is
+// O(pattern length * (maxEdits + 1)) with every row preallocated.
+class MelodyMatcher
+{
+public:
+    MelodyMatcher();
+    ~MelodyMatcher();
+
+    // Compilation (allocates; not for the audio thread)
+    void compile(const std::vector<std::vector<int>>& patterns);
+    void setMaxEdits(int edits);  // Inserted or dropped notes tolerated, recompiles
+
+    // Matching (real-time safe); returns the number of patterns matched by this note
+    void reset();
+    int processNote(int note);
+    const int* getMatches() const { return matches.data(); }
+    float getMatchCost(int matchIndex) const { return matchCosts[matchIndex]; }
+
+    // Settings
+    void setMaxCost(float semitones);       // Total interval error allowed, edits included
+    void setEditPenalty(float semitones);
+
+private:
+    struct Pattern
+    {
+        int rowOffset = 0;              // Into rows, for this pattern's row set
+        int numIntervals = 0;
+        int maxEdits = 0;
+        juce::int64 lastMatchNote = -2;
+    };
+
+    // Settings
+    int maxEdits = 1;
+    float maxCost = 1.0f;
+    float editPenalty = 0.5f;
+
+    // Compiled patterns
+    std::vector<std::vector<int>> patternNotes;
+    std::vector<Pattern> patterns;
+    std::vector<int> intervals;         // All patterns' intervals, back to back
+    std::vector<int> intervalOffsets;   // Start of each pattern's intervals
+
+    // DP rows: per pattern, 3 time steps x (maxEdits + 1) layers x (numIntervals + 1)
+    std::vector<float> rows;
+    int currentStep = 0;
+
+    // Input stream
+    int previousNote = -1;
+    int previousInterval = 0;
+    juce::int64 numNotes = 0;
+
+    // Results
+    std::vector<int> matches;
+    std::vector<float> matchCosts;
+    int numMatches = 0;
+
+    // Helper methods
+    float* getRow(const Pattern& pattern, int step, int edits);
+    bool advancePattern(int patternIndex, int interval, float& cost);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MelodyMatcher)
+};
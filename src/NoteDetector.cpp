@@ -0,0 +1,210 @@
+#include "NoteDetector.h"
+#include <cmath>
+#include <algorithm>
+
+NoteDetector::NoteDetector()
+{
+}
+
+NoteDetector::~NoteDetector()
+{
+}
+
+void NoteDetector::prepareToPlay(int newMaxWindowSize, double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    maxWindowSize = juce::jmax(64, newMaxWindowSize);
+
+    // Zero-pad to at least twice the window so the circular correlation
+    // computed by the FFT equals the linear autocorrelation for every lag we read
+    int order = 0;
+    while ((1 << order) < 2 * maxWindowSize)
+        ++order;
+
+    fftSize = 1 << order;
+    fft = std::make_unique<juce::dsp::FFT>(order);
+
+    fftBuffer.assign(2 * fftSize, 0.0f);
+    nsdf.assign(maxWindowSize, 0.0f);
+    lastClarity = 0.0f;
+}
+
+void NoteDetector::releaseResources()
+{
+    fft.reset();
+    fftSize = 0;
+    maxWindowSize = 0;
+    fftBuffer.clear();
+    nsdf.clear();
+}
+
+float NoteDetector::detectPitch(const float* samples, int numSamples)
+{
+    float frequency = detectFrequency(samples, numSamples);
+
+    if (frequency > 0.0f)
+        return 12.0f * std::log2(frequency / 440.0f) + 69.0f;
+
+    return -1.0f;
+}
+
+float NoteDetector::detectFrequency(const float* samples, int numSamples)
+{
+    lastClarity = 0.0f;
+
+    if (!fft || samples == nullptr || numSamples <= 0)
+        return -1.0f;
+
+    // Analyse the most recent samples if we were handed more than we prepared for
+    if (numSamples > maxWindowSize)
+    {
+        samples += numSamples - maxWindowSize;
+        numSamples = maxWindowSize;
+    }
+
+    const int minLag = juce::jmax(2, static_cast<int>(sampleRate / maxFrequency));
+    const int maxLag = juce::jmin(numSamples / 2, static_cast<int>(sampleRate / minFrequency));
+
+    if (maxLag <= minLag + 1)
+        return -1.0f;
+
+    computeAutocorrelation(samples, numSamples);
+
+    int bestLag = findBestPeak(minLag, maxLag);
+    if (bestLag <= 0)
+        return -1.0f;
+
+    float refinedLag = interpolatePeak(bestLag);
+    if (lastClarity < clarityThreshold || refinedLag <= 0.0f)
+        return -1.0f;
+
+    float frequency = static_cast<float>(sampleRate / refinedLag);
+
+    if (frequency > 20.0f && frequency < 20000.0f)
+        return frequency;
+
+    return -1.0f;
+}
+
+void NoteDetector::setClarityThreshold(float threshold)
+{
+    clarityThreshold = juce::jlimit(0.0f, 1.0f, threshold);
+}
+
+void NoteDetector::setFrequencyRange(float newMinFrequency, float newMaxFrequency)
+{
+    minFrequency = juce::jlimit(20.0f, 20000.0f, newMinFrequency);
+    maxFrequency = juce::jlimit(minFrequency, 20000.0f, newMaxFrequency);
+}
+
+void NoteDetector::computeAutocorrelation(const float* samples, int numSamples)
+{
+    // Wiener-Khinchin: the autocorrelation is the inverse FFT of the power spectrum
+    std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
+    std::copy(samples, samples + numSamples, fftBuffer.begin());
+
+    fft->performRealOnlyForwardTransform(fftBuffer.data());
+
+    for (int bin = 0; bin < fftSize; ++bin)
+    {
+        float re = fftBuffer[2 * bin];
+        float im = fftBuffer[2 * bin + 1];
+        fftBuffer[2 * bin] = re * re + im * im;
+        fftBuffer[2 * bin + 1] = 0.0f;
+    }
+
+    fft->performRealOnlyInverseTransform(fftBuffer.data());
+
+    // Rescale against the time-domain energy so the result doesn't depend on
+    // the normalisation convention of whichever FFT engine JUCE picked
+    float energy = 0.0f;
+    for (int i = 0; i < numSamples; ++i)
+        energy += samples[i] * samples[i];
+
+    const int numLags = juce::jmin(numSamples, static_cast<int>(nsdf.size()));
+
+    if (energy <= 0.0f || fftBuffer[0] <= 0.0f)
+    {
+        std::fill(nsdf.begin(), nsdf.begin() + numLags, 0.0f);
+        return;
+    }
+
+    const float scale = energy / fftBuffer[0];
+
+    // McLeod normalised square difference function:
+    // n(t) = 2 r(t) / m(t), with m(t) = sum of x[j]^2 + x[j+t]^2 updated incrementally
+    float m = 2.0f * energy;
+    for (int lag = 0; lag < numLags; ++lag)
+    {
+        if (lag > 0)
+            m -= samples[lag - 1] * samples[lag - 1] + samples[numSamples - lag] * samples[numSamples - lag];
+
+        nsdf[lag] = m > 1.0e-9f ? 2.0f * fftBuffer[lag] * scale / m : 0.0f;
+    }
+}
+
+int NoteDetector::findBestPeak(int minLag, int maxLag) const
+{
+    // Skip the lobe around lag zero
+    int start = 1;
+    while (start < maxLag && nsdf[start] > 0.0f)
+        ++start;
+    start = juce::jmax(start, minLag);
+
+    float globalMax = 0.0f;
+    for (int lag = start; lag < maxLag; ++lag)
+        globalMax = juce::jmax(globalMax, nsdf[lag]);
+
+    if (globalMax <= 0.0f)
+        return -1;
+
+    // Pick the first positive lobe whose maximum is close to the global one;
+    // this avoids the octave errors plain "highest peak" selection makes
+    const float cutoff = 0.9f * globalMax;
+    int lag = start;
+
+    while (lag < maxLag)
+    {
+        while (lag < maxLag && nsdf[lag] <= 0.0f)
+            ++lag;
+
+        int lobeMaxLag = -1;
+        float lobeMax = 0.0f;
+        while (lag < maxLag && nsdf[lag] > 0.0f)
+        {
+            if (nsdf[lag] > lobeMax)
+            {
+                lobeMax = nsdf[lag];
+                lobeMaxLag = lag;
+            }
+            ++lag;
+        }
+
+        // A maximum sitting on the search boundary is a truncated lobe, not a period
+        if (lobeMaxLag > 0 && lobeMaxLag < maxLag - 1 && lobeMax >= cutoff)
+            return lobeMaxLag;
+    }
+
+    return -1;
+}
+
+float NoteDetector::interpolatePeak(int lag)
+{
+    lastClarity = nsdf[lag];
+
+    if (lag <= 0 || lag + 1 >= static_cast<int>(nsdf.size()))
+        return static_cast<float>(lag);
+
+    float left = nsdf[lag - 1];
+    float centre = nsdf[lag];
+    float right = nsdf[lag + 1];
+    float denominator = left - 2.0f * centre + right;
+
+    if (std::abs(denominator) < 1.0e-9f)
+        return static_cast<float>(lag);
+
+    float delta = 0.5f * (left - right) / denominator;
+    lastClarity = centre - 0.25f * (left - right) * delta;
+
+    return static_cast<float>(lag) + delta;
+}
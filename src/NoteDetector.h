@@ -0,0 +1,54 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <memory>
+#include <vector>
+
+enum class PitchDetectionMethod
+{
+    Autocorrelation,     // Brute-force time-domain autocorrelation, O(N^2)
+    FFTAutocorrelation   // Wiener-Khinchin autocorrelation + McLeod peak picking, O(N log N)
+};
+
+class NoteDetector
+{
+public:
+    NoteDetector();
+    ~NoteDetector();
+
+    // Setup - allocates all FFT work buffers for windows up to maxWindowSize samples
+    void prepareToPlay(int maxWindowSize, double sampleRate);
+    void releaseResources();
+
+    // Pitch detection (real-time safe once prepared)
+    float detectPitch(const float* samples, int numSamples);      // MIDI note number, -1 if none
+    float detectFrequency(const float* samples, int numSamples);  // Hz, -1 if none
+    float getLastClarity() const { return lastClarity; }
+
+    // Settings
+    void setClarityThreshold(float threshold);
+    void setFrequencyRange(float minFrequency, float maxFrequency);
+
+private:
+    // Analysis parameters
+    double sampleRate = 44100.0;
+    int maxWindowSize = 0;
+    float clarityThreshold = 0.6f;
+    float minFrequency = 40.0f;
+    float maxFrequency = 2000.0f;
+    float lastClarity = 0.0f;
+
+    // FFT work buffers
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int fftSize = 0;
+    std::vector<float> fftBuffer;  // 2 * fftSize, as required by the real-only transforms
+    std::vector<float> nsdf;       // Normalised square difference function per lag
+
+    // Helper methods
+    void computeAutocorrelation(const float* samples, int numSamples);
+    int findBestPeak(int minLag, int maxLag) const;
+    float interpolatePeak(int lag);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NoteDetector)
+};
@@ -0,0 +1,190 @@
+#include "ProcessingLane.h"
+#include "TriggerManager.h"
+#include "EffectProcessor.h"
+#include "AudioAnalyzer.h"
+#include "AnalysisThread.h"
+
+ProcessingLane::ProcessingLane()
+{
+    triggerManager = std::make_unique<TriggerManager>();
+    effectProcessor = std::make_unique<EffectProcessor>();
+    audioAnalyzer = std::make_unique<AudioAnalyzer>();
+    analysisThread = std::make_unique<AnalysisThread>(*audioAnalyzer);
+}
+
+ProcessingLane::~ProcessingLane()
+{
+    // The worker references audioAnalyzer, so it has to go first
+    analysisThread.reset();
+}
+
+void ProcessingLane::prepareToPlay(int samplesPerBlockExpected, double sampleRate, int newFirstChannel,
+                                   int newNumChannels, AnalysisMode mode, RealtimeWorkerPool* workerPool)
+{
+    firstChannel = newFirstChannel;
+    numChannels = newNumChannels;
+
+    // prepareToPlay can come again without releaseResources, so stop the
+    // analysis thread before the analyzer's buffers are reallocated under it
+    analysisThread->stopThread(1000);
+
+    // Prepare components
+    triggerManager->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    effectProcessor->prepareToPlay(samplesPerBlockExpected, sampleRate, numChannels);
+    effectProcessor->setWorkerPool(workerPool);
+    audioAnalyzer->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    lastNoteEventSerial = audioAnalyzer->getMelodyDetector().getNumEvents();
+
+    // Latch the analysis mode so the analyzer is only ever driven by one thread
+    activeAnalysisMode = mode;
+
+    if (activeAnalysisMode == AnalysisMode::Background)
+    {
+        analysisThread->prepareToPlay(samplesPerBlockExpected, sampleRate);
+        analysisThread->startThread(juce::Thread::Priority::high);
+    }
+
+    prepared = true;
+}
+
+void ProcessingLane::releaseResources()
+{
+    analysisThread->stopThread(1000);
+    analysisThread->releaseResources();
+
+    triggerManager->releaseResources();
+    effectProcessor->releaseResources();
+    effectProcessor->setWorkerPool(nullptr);
+    audioAnalyzer->releaseResources();
+
+    prepared = false;
+}
+
+void ProcessingLane::processBlock(juce::AudioBuffer<float>& block, float inputGain, float outputGain,
+                                  CallbackProfiler* profiler)
+{
+    auto endStage = [profiler](CallbackProfiler::Stage stage)
+    {
+        if (profiler != nullptr)
+            profiler->endStage(stage);
+    };
+
+    // Analyze audio for triggers. The analysis downmix applies the input gain
+    // as it reads, so the block itself isn't scaled for it.
+    if (activeAnalysisMode == AnalysisMode::Background)
+        analysisThread->pushAudio(block, inputGain);
+    else
+        audioAnalyzer->processAudio(block, inputGain);
+    endStage(CallbackProfiler::Stage::Analysis);
+
+    checkTriggers(block.getNumSamples());
+    endStage(CallbackProfiler::Stage::Triggers);
+
+    // Apply effects, with the input gain ahead of them. When nothing would
+    // touch the audio, both gains go on together in a single pass.
+    float remainingGain = inputGain * outputGain;
+
+    if (effectProcessor->isProcessing())
+    {
+        applyGain(block, inputGain);
+        endStage(CallbackProfiler::Stage::Input);
+
+        effectProcessor->processAudio(block);
+        endStage(CallbackProfiler::Stage::Effects);
+
+        remainingGain = outputGain;
+    }
+
+    // Apply output gain
+    applyGain(block, remainingGain);
+    endStage(CallbackProfiler::Stage::Output);
+}
+
+float ProcessingLane::getCurrentNote() const
+{
+    if (activeAnalysisMode == AnalysisMode::Background)
+        return analysisThread->getCurrentNote();
+    return audioAnalyzer->getCurrentNote();
+}
+
+float ProcessingLane::getCurrentChord() const
+{
+    if (activeAnalysisMode == AnalysisMode::Background)
+        return analysisThread->getCurrentChord();
+    return audioAnalyzer->getCurrentChord();
+}
+
+int ProcessingLane::getCurrentChordId() const
+{
+    if (activeAnalysisMode == AnalysisMode::Background)
+        return analysisThread->getCurrentChordState().chordId;
+    return audioAnalyzer->getCurrentChordId();
+}
+
+ChordInfo ProcessingLane::getCurrentChordInfo() const
+{
+    if (activeAnalysisMode == AnalysisMode::Background)
+    {
+        const auto state = analysisThread->getCurrentChordState();
+        return audioAnalyzer->getChordDetector().getChordInfo(state.chordId, state.score);
+    }
+    return audioAnalyzer->getCurrentChordInfo();
+}
+
+float ProcessingLane::getCurrentMelody() const
+{
+    if (activeAnalysisMode == AnalysisMode::Background)
+        return analysisThread->getCurrentMelody();
+    return audioAnalyzer->getCurrentMelody();
+}
+
+void ProcessingLane::applyGain(juce::AudioBuffer<float>& buffer, float gain)
+{
+    if (gain == 1.0f)
+        return;
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel), gain, buffer.getNumSamples());
+}
+
+void ProcessingLane::checkTriggers(int numSamples)
+{
+    // Get current detected note/chord, either straight from the analyzer
+    // or as last published by the analysis thread
+    float currentNote = getCurrentNote();
+    int currentChordMask = audioAnalyzer->getChordDetector().getChordPitchClassMask(getCurrentChordId());
+
+    // Melody triggers advance once per new note event
+    processNoteEvents();
+
+    // Check for triggers; hold times count the samples this sub-block covers
+    triggerManager->checkTriggers(currentNote, currentChordMask, numSamples);
+
+    // The most recently fired trigger picks the switched effect
+    effectProcessor->setActiveEffect(triggerManager->getActiveEffectId());
+}
+
+void ProcessingLane::processNoteEvents()
+{
+    // Every event since the last callback, oldest first: a long callback runs
+    // several analysis hops, and the analysis thread can catch up on several
+    // in a burst, but a melody needs each of its notes
+    int note = -1;
+
+    if (activeAnalysisMode == AnalysisMode::Background)
+    {
+        while (analysisThread->popNoteEvent(note))
+            triggerManager->processNoteEvent(note);
+        return;
+    }
+
+    const auto& melodyDetector = audioAnalyzer->getMelodyDetector();
+    const juce::uint32 serial = melodyDetector.getNumEvents();
+    const int numNewEvents = static_cast<int>(juce::jmin(serial - lastNoteEventSerial,
+                                                         static_cast<juce::uint32>(melodyDetector.getNumStoredEvents())));
+    lastNoteEventSerial = serial;
+
+    for (int i = numNewEvents - 1; i >= 0; --i)
+        triggerManager->processNoteEvent(melodyDetector.getEvent(i).note);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "CallbackProfiler.h"
+#include <memory>
+
+class TriggerManager;
+class EffectProcessor;
+class AudioAnalyzer;
+class AnalysisThread;
+class RealtimeWorkerPool;
+struct ChordInfo;
+
+enum class AnalysisMode
+{
+    Synchronous,  // Analyzer runs inside getNextAudioBlock
+    Background    // Audio thread only feeds a FIFO; AnalysisThread runs the analyzer
+};
+
+// One input's path through the app: its own analyzer, triggers and effects,
+// run in place over a contiguous group of the device's channels. Lanes share
+// no state, so AudioProcessor can run them in any order.
+class ProcessingLane
+{
+public:
+    ProcessingLane();
+    ~ProcessingLane();
+
+    // Setup (audio stopped). The lane covers numChannels device channels from
+    // firstChannel; its effects spread channels over workerPool when it's set.
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate, int firstChannel, int numChannels,
+                       AnalysisMode mode, RealtimeWorkerPool* workerPool = nullptr);
+    void releaseResources();
+    bool isPrepared() const { return prepared; }
+    int getFirstChannel() const { return firstChannel; }
+    int getNumChannels() const { return numChannels; }
+
+    // Audio thread: analysis, triggers and effects over the lane's channels, in
+    // place. Stages are stamped on profiler unless it's null (lanes running
+    // concurrently can't share its stage clock).
+    void processBlock(juce::AudioBuffer<float>& block, float inputGain, float outputGain, CallbackProfiler* profiler);
+
+    // Analysis results, from the analyzer or as last published by the analysis thread
+    float getCurrentNote() const;
+    float getCurrentChord() const;
+    float getCurrentMelody() const;
+    int getCurrentChordId() const;
+    ChordInfo getCurrentChordInfo() const; // Message thread; id and score from the same analysis hop
+
+    // Access to components
+    TriggerManager* getTriggerManager() const { return triggerManager.get(); }
+    EffectProcessor* getEffectProcessor() const { return effectProcessor.get(); }
+    AudioAnalyzer* getAudioAnalyzer() const { return audioAnalyzer.get(); }
+    AnalysisThread* getAnalysisThread() const { return analysisThread.get(); }
+
+private:
+    // Processing components
+    std::unique_ptr<TriggerManager> triggerManager;
+    std::unique_ptr<EffectProcessor> effectProcessor;
+    std::unique_ptr<AudioAnalyzer> audioAnalyzer;
+    std::unique_ptr<AnalysisThread> analysisThread;
+
+    // Layout and state, latched by prepareToPlay
+    bool prepared = false;
+    int firstChannel = 0;
+    int numChannels = 0;
+    AnalysisMode activeAnalysisMode = AnalysisMode::Synchronous;
+    juce::uint32 lastNoteEventSerial = 0; // Synchronous mode; the analysis thread tracks its own
+
+    // Processing methods
+    static void applyGain(juce::AudioBuffer<float>& buffer, float gain);
+    void checkTriggers(int numSamples);
+    void processNoteEvents();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessingLane)
+};
@@ -1,113 +1,246 @@
 #include "TriggerManager.h"
+#include "TriggerProgram.h"
+#include <algorithm>
+
+// Waits for edits and compiles them into a new program off the audio thread
+class TriggerManager::ProgramBuilder : public juce::Thread
+{
+public:
+    explicit ProgramBuilder(TriggerManager& owner)
+        : juce::Thread("Trigger program builder"), manager(owner)
+    {
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            wait(-1);
+
+            if (!threadShouldExit())
+                manager.buildAndPublish();
+        }
+    }
+
+private:
+    TriggerManager& manager;
+};
 
 TriggerManager::TriggerManager()
 {
+    program = new TriggerProgram({}, melodyMatchSettings);
+    retiredPrograms.resize(static_cast<size_t>(retiredFifo.getTotalSize()), nullptr);
+
+    builder = std::make_unique<ProgramBuilder>(*this);
+    builder->startThread(juce::Thread::Priority::low);
 }
 
 TriggerManager::~TriggerManager()
 {
+    builder->signalThreadShouldExit();
+    builder->notify();
+    builder->stopThread(1000);
+    builder.reset();
+
+    delete pendingProgram.exchange(nullptr);
+    delete program;
+    collectRetiredPrograms();
 }
 
 void TriggerManager::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
     this->sampleRate = sampleRate;
     this->blockSize = samplesPerBlockExpected;
+    program->melodyAutomaton.reset();
+    program->melodyMatcher.reset();
 }
 
 void TriggerManager::releaseResources()
 {
-    triggers.clear();
-    triggerTimers.clear();
-    triggerStates.clear();
+    // Definitions survive a stop (a device or channel layout change goes
+    // through here too); only the runtime state is reset. The audio thread
+    // is stopped, so take the newest program over right here.
+    publishPendingChanges();
+    adoptPendingProgram();
+    collectRetiredPrograms();
+
+    while (!program->activeTriggerSlots.empty())
+        deactivateSlot(program->activeTriggerSlots.back());
+
+    program->melodyAutomaton.reset();
+    program->melodyMatcher.reset();
     activeEffectId = -1;
 }
 
 int TriggerManager::addNoteTrigger(int note, int effectId, float threshold)
 {
     std::vector<int> notes = {note};
-    Trigger trigger(nextTriggerId++, TriggerType::Note, notes, effectId, threshold);
-    triggers.push_back(trigger);
-    return trigger.id;
+    return addTrigger(TriggerType::Note, notes, effectId, threshold);
 }
 
 int TriggerManager::addChordTrigger(const std::vector<int>& notes, int effectId, float threshold)
 {
-    Trigger trigger(nextTriggerId++, TriggerType::Chord, notes, effectId, threshold);
-    triggers.push_back(trigger);
-    return trigger.id;
+    return addTrigger(TriggerType::Chord, notes, effectId, threshold);
 }
 
 int TriggerManager::addMelodyTrigger(const std::vector<int>& sequence, int effectId, float threshold)
 {
-    Trigger trigger(nextTriggerId++, TriggerType::Melody, sequence, effectId, threshold);
-    triggers.push_back(trigger);
-    return trigger.id;
+    return addTrigger(TriggerType::Melody, sequence, effectId, threshold);
+}
+
+int TriggerManager::addTrigger(TriggerType type, const std::vector<int>& notes, int effectId, float threshold)
+{
+    int triggerId = -1;
+    {
+        const juce::ScopedLock definitionScope(definitionLock);
+        triggerId = nextTriggerId++;
+        triggers.emplace_back(triggerId, type, notes, effectId, threshold);
+        ++definitionVersion;
+    }
+
+    requestRebuild();
+    notifyTargetsChanged();
+    return triggerId;
+}
+
+void TriggerManager::setTriggers(const std::vector<Trigger>& newTriggers)
+{
+    {
+        const juce::ScopedLock definitionScope(definitionLock);
+        triggers = newTriggers;
+        for (const auto& trigger : triggers)
+            nextTriggerId = juce::jmax(nextTriggerId, trigger.id + 1);
+        ++definitionVersion;
+    }
+
+    requestRebuild();
+    notifyTargetsChanged();
 }
 
 void TriggerManager::removeTrigger(int triggerId)
 {
-    auto it = std::find_if(triggers.begin(), triggers.end(),
-                          [triggerId](const Trigger& t) { return t.id == triggerId; });
-    if (it != triggers.end())
+    const int index = findTriggerIndex(triggerId);
+    if (index >= 0)
     {
-        deactivateTrigger(*it);
-        triggers.erase(it);
+        {
+            const juce::ScopedLock definitionScope(definitionLock);
+            triggers.erase(triggers.begin() + index);
+            ++definitionVersion;
+        }
+
+        requestRebuild();
+        notifyTargetsChanged();
     }
 }
 
 void TriggerManager::enableTrigger(int triggerId, bool enabled)
 {
-    auto it = std::find_if(triggers.begin(), triggers.end(),
-                          [triggerId](const Trigger& t) { return t.id == triggerId; });
-    if (it != triggers.end())
+    const int index = findTriggerIndex(triggerId);
+    if (index >= 0)
     {
-        it->enabled = enabled;
-        if (!enabled)
-            deactivateTrigger(*it);
+        {
+            const juce::ScopedLock definitionScope(definitionLock);
+            triggers[index].enabled = enabled;
+            ++definitionVersion;
+        }
+
+        requestRebuild();
+        notifyTargetsChanged();
     }
 }
 
 void TriggerManager::setTriggerThreshold(int triggerId, float threshold)
 {
-    auto it = std::find_if(triggers.begin(), triggers.end(),
-                          [triggerId](const Trigger& t) { return t.id == triggerId; });
-    if (it != triggers.end())
+    const int index = findTriggerIndex(triggerId);
+    if (index >= 0)
+    {
+        {
+            const juce::ScopedLock definitionScope(definitionLock);
+            triggers[index].threshold = juce::jlimit(0.0f, 1.0f, threshold);
+            ++definitionVersion;
+        }
+
+        requestRebuild();
+    }
+}
+
+void TriggerManager::setMelodyMatchSettings(const MelodyMatchSettings& settings)
+{
     {
-        it->threshold = juce::jlimit(0.0f, 1.0f, threshold);
+        const juce::ScopedLock definitionScope(definitionLock);
+        melodyMatchSettings = settings;
+        ++definitionVersion;
     }
+
+    requestRebuild();
 }
 
-void TriggerManager::checkTriggers(float currentNote, float currentChord, float currentMelody)
+void TriggerManager::publishPendingChanges()
 {
-    updateTimers();
-    
-    for (const auto& trigger : triggers)
+    buildAndPublish();
+}
+
+void TriggerManager::checkTriggers(float currentNote, int currentChordMask, int numSamples)
+{
+    adoptPendingProgram();
+    auto& state = *program;
+
+    // Age the active triggers and release the ones that are done; only the
+    // active ones need looking at. Walking backwards keeps the swap-removal safe.
+    for (int i = static_cast<int>(state.activeTriggerSlots.size()) - 1; i >= 0; --i)
     {
-        if (!trigger.enabled)
-            continue;
-            
-        bool shouldActivate = false;
-        
+        const int slot = state.activeTriggerSlots[i];
+        const auto& trigger = state.triggers[slot];
+        state.remainingSamples[slot] = juce::jmax(0, state.remainingSamples[slot] - numSamples);
+
+        bool stillMatches = false;
         switch (trigger.type)
         {
             case TriggerType::Note:
-                shouldActivate = checkNoteTrigger(trigger, currentNote);
+                stillMatches = checkNoteTrigger(trigger, currentNote);
                 break;
             case TriggerType::Chord:
-                shouldActivate = checkChordTrigger(trigger, currentChord);
+                stillMatches = checkChordTrigger(slot, currentChordMask);
                 break;
             case TriggerType::Melody:
-                shouldActivate = checkMelodyTrigger(trigger, currentMelody);
-                break;
+                // Fired by processNoteEvent, released by its timer
+                if (state.remainingSamples[slot] == 0)
+                    deactivateSlot(slot);
+                continue;
         }
-        
-        if (shouldActivate)
+
+        // Note and chord triggers hold for their duration, then release after
+        // a few consecutive misses so a flickering detection doesn't toggle them
+        state.missCounts[slot] = stillMatches ? 0 : state.missCounts[slot] + 1;
+
+        if (state.remainingSamples[slot] == 0 && state.missCounts[slot] >= releaseHysteresis)
+            deactivateSlot(slot);
+    }
+
+    // Then fire whatever the current note and chord select
+    if (currentNote >= 0)
+    {
+        const int note = juce::roundToInt(currentNote);
+        if (note >= 0 && note < static_cast<int>(state.noteTriggerSlots.size()))
         {
-            activateTrigger(trigger);
+            for (int slot : state.noteTriggerSlots[note])
+            {
+                if (state.triggers[slot].enabled)
+                    activateSlot(slot);
+            }
         }
-        else
+    }
+
+    if (currentChordMask != 0)
+    {
+        auto it = state.chordTriggerSlots.find(currentChordMask);
+        if (it != state.chordTriggerSlots.end())
         {
-            deactivateTrigger(trigger);
+            for (int slot : it->second)
+            {
+                if (state.triggers[slot].enabled)
+                    activateSlot(slot);
+            }
         }
     }
 }
@@ -117,17 +250,34 @@ void TriggerManager::setTriggerCallback(std::function<void(int effectId, bool ac
     triggerCallback = callback;
 }
 
+void TriggerManager::setTargetsChangedCallback(std::function<void()> callback)
+{
+    targetsChangedCallback = callback;
+}
+
+int TriggerManager::findTriggerIndex(int triggerId) const
+{
+    auto it = std::find_if(triggers.begin(), triggers.end(),
+                           [triggerId](const Trigger& t) { return t.id == triggerId; });
+    return it != triggers.end() ? static_cast<int>(it - triggers.begin()) : -1;
+}
+
 bool TriggerManager::isTriggerActive(int triggerId) const
 {
-    auto it = triggerStates.find(triggerId);
-    return it != triggerStates.end() && it->second;
+    const int slot = program->findSlot(triggerId);
+    return slot >= 0 && program->activeFlags[slot] != 0;
+}
+
+void TriggerManager::setReleaseHysteresis(int checks)
+{
+    releaseHysteresis = juce::jlimit(1, 64, checks);
 }
 
 bool TriggerManager::checkNoteTrigger(const Trigger& trigger, float currentNote)
 {
     if (currentNote < 0)
         return false;
-        
+
     // Check if current note matches any note in the trigger
     for (int note : trigger.notes)
     {
@@ -137,94 +287,194 @@ bool TriggerManager::checkNoteTrigger(const Trigger& trigger, float currentNote)
     return false;
 }
 
-bool TriggerManager::checkChordTrigger(const Trigger& trigger, float currentChord)
+bool TriggerManager::checkChordTrigger(int slot, int currentChordMask) const
 {
-    if (currentChord < 0)
-        return false;
-        
-    // For now, we'll use a simple approach where we check if the chord root matches
-    // In a real implementation, you'd want more sophisticated chord detection
-    int chordRoot = static_cast<int>(currentChord) % 12;
-    
-    for (int note : trigger.notes)
+    // Same test that fired it: the detected chord has exactly the trigger's pitch classes
+    return currentChordMask != 0 && program->chordMasks[slot] == currentChordMask;
+}
+
+void TriggerManager::processNoteEvent(int note)
+{
+    adoptPendingProgram();
+    auto& state = *program;
+
+    // Both matchers see every note so switching modes never starts from a stale state
+    const int numExactMatches = state.melodyAutomaton.advance(note);
+    const int numFuzzyMatches = state.melodyMatcher.processNote(note);
+
+    const bool fuzzy = melodyMatchMode == MelodyMatchMode::Fuzzy;
+    const int numMatches = fuzzy ? numFuzzyMatches : numExactMatches;
+    const int* matches = fuzzy ? state.melodyMatcher.getMatches() : state.melodyAutomaton.getMatches();
+
+    for (int i = 0; i < numMatches; ++i)
     {
-        if (note % 12 == chordRoot)
-            return true;
+        const int slot = state.melodyTriggerIndices[matches[i]];
+        if (!state.triggers[slot].enabled)
+            continue;
+
+        // A repeat of the phrase while still active restarts the hold time
+        if (state.activeFlags[slot] != 0)
+            state.remainingSamples[slot] = static_cast<int>(state.triggers[slot].duration * sampleRate / 1000.0);
+        else
+            activateSlot(slot);
     }
-    return false;
 }
 
-bool TriggerManager::checkMelodyTrigger(const Trigger& trigger, float currentMelody)
+void TriggerManager::setMelodyMatchMode(MelodyMatchMode mode)
 {
-    if (currentMelody < 0)
-        return false;
-        
-    // For melody triggers, we'd need to maintain a history of recent notes
-    // and check if they match the sequence. This is a simplified version.
-    // In a real implementation, you'd want to track the melody sequence over time.
-    
-    // For now, just check if the current melody note matches the first note in the sequence
-    if (!trigger.notes.empty())
+    melodyMatchMode = mode;
+}
+
+void TriggerManager::requestRebuild()
+{
+    builder->notify();
+}
+
+void TriggerManager::notifyTargetsChanged()
+{
+    if (targetsChangedCallback)
+        targetsChangedCallback();
+}
+
+void TriggerManager::buildAndPublish()
+{
+    const juce::ScopedLock buildScope(buildLock);
+    collectRetiredPrograms();
+
+    std::vector<Trigger> definitions;
+    MelodyMatchSettings settings;
+    juce::uint32 version = 0;
     {
-        return std::abs(currentMelody - trigger.notes[0]) < 0.5f;
+        const juce::ScopedLock definitionScope(definitionLock);
+        if (definitionVersion == publishedVersion)
+            return; // Already built, e.g. by publishPendingChanges
+
+        definitions = triggers;
+        settings = melodyMatchSettings;
+        version = definitionVersion;
+    }
+
+    auto* built = new TriggerProgram(definitions, settings);
+    publishedVersion = version;
+
+    // A program the audio thread never picked up can be freed straight away
+    delete pendingProgram.exchange(built, std::memory_order_acq_rel);
+}
+
+void TriggerManager::collectRetiredPrograms()
+{
+    const juce::ScopedLock buildScope(buildLock);
+
+    for (;;)
+    {
+        int start1, size1, start2, size2;
+        retiredFifo.prepareToRead(1, start1, size1, start2, size2);
+        if (size1 + size2 < 1)
+            break;
+
+        auto* retired = retiredPrograms[size1 > 0 ? start1 : start2];
+        retiredFifo.finishedRead(1);
+        delete retired;
     }
-    return false;
 }
 
-void TriggerManager::activateTrigger(const Trigger& trigger)
+void TriggerManager::adoptPendingProgram()
 {
-    if (triggerStates[trigger.id])
+    auto* next = pendingProgram.exchange(nullptr, std::memory_order_acq_rel);
+    if (next == nullptr)
+        return;
+
+    // Carry the active triggers over by id; the rest of the new state starts clear.
+    // Only the active ones are visited, so this costs nothing for a big idle set.
+    auto* previous = program;
+    for (int slot : previous->activeTriggerSlots)
+    {
+        const auto& trigger = previous->triggers[slot];
+        const int newSlot = next->findSlot(trigger.id);
+
+        if (newSlot >= 0 && next->triggers[newSlot].enabled)
+        {
+            next->activeFlags[newSlot] = 1;
+            next->remainingSamples[newSlot] = previous->remainingSamples[slot];
+            next->missCounts[newSlot] = previous->missCounts[slot];
+            next->activeListPositions[newSlot] = static_cast<int>(next->activeTriggerSlots.size());
+            next->activeTriggerSlots.push_back(newSlot); // Within the reserved capacity
+        }
+        else
+        {
+            // Removed or disabled while active
+            if (activeEffectId == trigger.effectId)
+                activeEffectId = -1;
+
+            if (triggerCallback)
+                triggerCallback(trigger.effectId, false);
+        }
+    }
+
+    program = next;
+
+    // Freed by the builder; with the FIFO full it leaks rather than free here
+    int start1, size1, start2, size2;
+    retiredFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 > 0)
+    {
+        retiredPrograms[size1 > 0 ? start1 : start2] = previous;
+        retiredFifo.finishedWrite(1);
+    }
+}
+
+void TriggerManager::activateSlot(int slot)
+{
+    auto& state = *program;
+
+    if (state.activeFlags[slot] != 0)
+    {
+        state.missCounts[slot] = 0;
         return; // Already active
-        
-    triggerStates[trigger.id] = true;
-    triggerTimers[trigger.id] = trigger.duration;
-    
+    }
+
+    const auto& trigger = state.triggers[slot];
+
+    state.activeFlags[slot] = 1;
+    state.remainingSamples[slot] = static_cast<int>(trigger.duration * sampleRate / 1000.0);
+    state.missCounts[slot] = 0;
+    state.activeListPositions[slot] = static_cast<int>(state.activeTriggerSlots.size());
+    state.activeTriggerSlots.push_back(slot); // Within the reserved capacity
+
     // Set as active effect
     activeEffectId = trigger.effectId;
-    
+
     // Call callback
     if (triggerCallback)
         triggerCallback(trigger.effectId, true);
 }
 
-void TriggerManager::deactivateTrigger(const Trigger& trigger)
+void TriggerManager::deactivateSlot(int slot)
 {
-    if (!triggerStates[trigger.id])
+    auto& state = *program;
+
+    if (state.activeFlags[slot] == 0)
         return; // Already inactive
-        
-    triggerStates[trigger.id] = false;
-    triggerTimers.erase(trigger.id);
-    
+
+    const auto& trigger = state.triggers[slot];
+
+    state.activeFlags[slot] = 0;
+    state.remainingSamples[slot] = 0;
+    state.missCounts[slot] = 0;
+
+    // Swap-remove from the active list
+    const int position = state.activeListPositions[slot];
+    const int lastSlot = state.activeTriggerSlots.back();
+    state.activeTriggerSlots[position] = lastSlot;
+    state.activeListPositions[lastSlot] = position;
+    state.activeTriggerSlots.pop_back();
+    state.activeListPositions[slot] = -1;
+
     // If this was the active effect, clear it
     if (activeEffectId == trigger.effectId)
         activeEffectId = -1;
-    
+
     // Call callback
     if (triggerCallback)
         triggerCallback(trigger.effectId, false);
 }
-
-void TriggerManager::updateTimers()
-{
-    std::vector<int> expiredTriggers;
-    
-    for (auto& timer : triggerTimers)
-    {
-        timer.second -= blockSize;
-        if (timer.second <= 0)
-        {
-            expiredTriggers.push_back(timer.first);
-        }
-    }
-    
-    // Deactivate expired triggers
-    for (int triggerId : expiredTriggers)
-    {
-        auto it = std::find_if(triggers.begin(), triggers.end(),
-                              [triggerId](const Trigger& t) { return t.id == triggerId; });
-        if (it != triggers.end())
-        {
-            deactivateTrigger(*it);
-        }
-    }
-} 
\ No newline at end of file
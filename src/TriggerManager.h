@@ -1,10 +1,13 @@
 #pragma once
 
 #include <juce_audio_basics/juce_audio_basics.h>
+#include <atomic>
+#include <memory>
 #include <vector>
-#include <map>
 #include <functional>
 
+struct TriggerProgram;
+
 enum class TriggerType
 {
     Note,
@@ -12,6 +15,20 @@ enum class TriggerType
     Melody
 };
 
+enum class MelodyMatchMode
+{
+    Exact,  // Absolute pitches in order, Aho-Corasick automaton
+    Fuzzy   // Intervals with transposition and one extra or missing note tolerated
+};
+
+// Fuzzy matcher settings, compiled into each trigger program
+struct MelodyMatchSettings
+{
+    float maxCost = 1.0f;      // Semitones of interval error, edits included
+    float editPenalty = 0.5f;  // Semitones charged per extra or dropped note
+    int maxEdits = 1;
+};
+
 struct Trigger
 {
     int id;
@@ -20,7 +37,7 @@ struct Trigger
     int effectId;
     bool enabled;
     float threshold;
-    int duration;
+    int duration; // Milliseconds a trigger stays active once fired
     
     Trigger(int triggerId, TriggerType triggerType, const std::vector<int>& triggerNotes, 
             int triggerEffectId, float triggerThreshold = 0.5f, int triggerDuration = 100)
@@ -28,6 +45,11 @@ struct Trigger
           enabled(true), threshold(triggerThreshold), duration(triggerDuration) {}
 };
 
+// Trigger definitions are edited on the message thread and compiled into a
+// TriggerProgram on a background builder thread. The audio thread picks up the
+// newest program with a single atomic exchange at the start of checkTriggers or
+// processNoteEvent, carrying over whichever triggers are still active, and
+// hands the old one back to be freed off the audio thread.
 class TriggerManager
 {
 public:
@@ -36,36 +58,58 @@ public:
 
     // Setup
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
-    void releaseResources();
+    void releaseResources(); // Releases active triggers; the definitions are kept
 
-    // Trigger management
+    // Trigger management (message thread; takes effect once the rebuilt program is published)
     int addNoteTrigger(int note, int effectId, float threshold = 0.5f);
     int addChordTrigger(const std::vector<int>& notes, int effectId, float threshold = 0.5f);
     int addMelodyTrigger(const std::vector<int>& sequence, int effectId, float threshold = 0.5f);
+    void setTriggers(const std::vector<Trigger>& newTriggers); // Replaces the set with a single rebuild
     void removeTrigger(int triggerId);
     void enableTrigger(int triggerId, bool enabled);
     void setTriggerThreshold(int triggerId, float threshold);
+    void setMelodyMatchSettings(const MelodyMatchSettings& settings);
+    void publishPendingChanges(); // Builds on the calling thread instead of waiting for the builder
 
-    // Trigger checking
-    void checkTriggers(float currentNote, float currentChord, float currentMelody);
+    // Trigger checking (audio thread)
+    void checkTriggers(float currentNote, int currentChordMask, int numSamples); // Chord as a pitch-class mask, 0 for none; numSamples since the last check
+    void processNoteEvent(int note); // Once per note onset; drives melody triggers
+    void setMelodyMatchMode(MelodyMatchMode mode);
+    MelodyMatchMode getMelodyMatchMode() const { return melodyMatchMode; }
+    void setReleaseHysteresis(int checks); // Consecutive misses before a note/chord trigger releases
     
     // Callbacks
     void setTriggerCallback(std::function<void(int effectId, bool activated)> callback);
+    void setTargetsChangedCallback(std::function<void()> callback); // On the editing thread, after triggers are added, removed, replaced or toggled
     
     // Getters
-    const std::vector<Trigger>& getTriggers() const { return triggers; }
-    bool isTriggerActive(int triggerId) const;
+    const std::vector<Trigger>& getTriggers() const { return triggers; } // Message thread's definitions
+    bool isTriggerActive(int triggerId) const;                           // Audio thread's view
     int getActiveEffectId() const { return activeEffectId; }
 
 private:
-    // Triggers
+    class ProgramBuilder;
+
+    // Definitions (message thread); the builder copies them under the lock
     std::vector<Trigger> triggers;
     int nextTriggerId = 1;
+    MelodyMatchSettings melodyMatchSettings;
+    juce::uint32 definitionVersion = 0;  // Bumped on every edit
+    juce::uint32 publishedVersion = 0;   // Version of the newest program built
+    juce::CriticalSection definitionLock;
+    juce::CriticalSection buildLock;
+    
+    // Compiled programs
+    TriggerProgram* program = nullptr;                        // Audio thread's, owned
+    std::atomic<TriggerProgram*> pendingProgram { nullptr };  // Published, not yet picked up
+    juce::AbstractFifo retiredFifo { 32 };                    // Audio thread -> builder, for deletion
+    std::vector<TriggerProgram*> retiredPrograms;
+    std::unique_ptr<ProgramBuilder> builder;
     
-    // State
+    // Matching settings
+    MelodyMatchMode melodyMatchMode = MelodyMatchMode::Fuzzy;
+    int releaseHysteresis = 2;
     int activeEffectId = -1;
-    std::map<int, int> triggerTimers; // triggerId -> timer
-    std::map<int, bool> triggerStates; // triggerId -> active state
     
     // Audio parameters
     double sampleRate = 44100.0;
@@ -73,14 +117,20 @@ private:
     
     // Callback
     std::function<void(int effectId, bool activated)> triggerCallback;
+    std::function<void()> targetsChangedCallback;
     
     // Helper methods
     bool checkNoteTrigger(const Trigger& trigger, float currentNote);
-    bool checkChordTrigger(const Trigger& trigger, float currentChord);
-    bool checkMelodyTrigger(const Trigger& trigger, float currentMelody);
-    void activateTrigger(const Trigger& trigger);
-    void deactivateTrigger(const Trigger& trigger);
-    void updateTimers();
+    bool checkChordTrigger(int slot, int currentChordMask) const;
+    int addTrigger(TriggerType type, const std::vector<int>& notes, int effectId, float threshold);
+    int findTriggerIndex(int triggerId) const;
+    void requestRebuild();
+    void notifyTargetsChanged();
+    void buildAndPublish();
+    void collectRetiredPrograms();
+    void adoptPendingProgram();
+    void activateSlot(int slot);
+    void deactivateSlot(int slot);
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TriggerManager)
-}; 
\ No newline at end of file
+};
\ No newline at end of file
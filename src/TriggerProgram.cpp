@@ -0,0 +1,73 @@
+#include "TriggerProgram.h"
+#include <algorithm>
+
+TriggerProgram::TriggerProgram(const std::vector<Trigger>& definitions, const MelodyMatchSettings& matchSettings)
+    : triggers(definitions)
+{
+    const int numTriggers = static_cast<int>(triggers.size());
+
+    std::vector<std::vector<int>> patterns;
+    triggerSlots.reserve(numTriggers);
+    chordMasks.assign(numTriggers, 0);
+
+    for (int slot = 0; slot < numTriggers; ++slot)
+    {
+        const auto& trigger = triggers[slot];
+        triggerSlots[trigger.id] = slot;
+
+        switch (trigger.type)
+        {
+            case TriggerType::Note:
+                for (int note : trigger.notes)
+                {
+                    auto& slots = noteTriggerSlots[juce::jlimit(0, 127, note)];
+                    if (std::find(slots.begin(), slots.end(), slot) == slots.end())
+                        slots.push_back(slot);
+                }
+                break;
+
+            case TriggerType::Chord:
+                // Filed under its pitch-class set, so only that chord (in any
+                // voicing or inversion) fires it
+                chordMasks[slot] = getPitchClassMask(trigger.notes);
+                if (chordMasks[slot] != 0)
+                    chordTriggerSlots[chordMasks[slot]].push_back(slot);
+                break;
+
+            case TriggerType::Melody:
+                patterns.push_back(trigger.notes);
+                melodyTriggerIndices.push_back(slot);
+                break;
+        }
+    }
+
+    melodyAutomaton.compile(patterns);
+    melodyMatcher.setMaxCost(matchSettings.maxCost);
+    melodyMatcher.setEditPenalty(matchSettings.editPenalty);
+    melodyMatcher.setMaxEdits(matchSettings.maxEdits);
+    melodyMatcher.compile(patterns);
+
+    activeFlags.assign(numTriggers, 0);
+    remainingSamples.assign(numTriggers, 0);
+    missCounts.assign(numTriggers, 0);
+    activeListPositions.assign(numTriggers, -1);
+    activeTriggerSlots.reserve(numTriggers);
+}
+
+TriggerProgram::~TriggerProgram()
+{
+}
+
+int TriggerProgram::getPitchClassMask(const std::vector<int>& notes)
+{
+    int mask = 0;
+    for (int note : notes)
+        mask |= 1 << (((note % 12) + 12) % 12);
+    return mask;
+}
+
+int TriggerProgram::findSlot(int triggerId) const
+{
+    auto it = triggerSlots.find(triggerId);
+    return it != triggerSlots.end() ? it->second : -1;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "TriggerManager.h"
+#include "MelodyAutomaton.h"
+#include "MelodyMatcher.h"
+#include <array>
+#include <vector>
+#include <unordered_map>
+
+// Compiled form of a trigger set. TriggerManager builds one off the audio thread
+// whenever the triggers change and publishes it whole, so the audio thread never
+// sees a half-rebuilt index. The tables are immutable once built; the runtime
+// state and the melody matchers' cursors are preallocated here too and only the
+// audio thread touches them after publication.
+struct TriggerProgram
+{
+    TriggerProgram(const std::vector<Trigger>& definitions, const MelodyMatchSettings& matchSettings);
+    ~TriggerProgram();
+
+    int findSlot(int triggerId) const;
+    int getNumTriggers() const { return static_cast<int>(triggers.size()); }
+    static int getPitchClassMask(const std::vector<int>& notes); // Bit n set for pitch class n
+
+    // Compiled tables
+    std::vector<Trigger> triggers;
+    std::array<std::vector<int>, 128> noteTriggerSlots;   // MIDI note -> note triggers
+    std::unordered_map<int, std::vector<int>> chordTriggerSlots; // Pitch-class mask -> chord triggers
+    std::vector<int> chordMasks;                          // Slot -> pitch-class mask (chord triggers only)
+    std::unordered_map<int, int> triggerSlots;            // Trigger id -> slot
+    std::vector<int> melodyTriggerIndices;                // Pattern index -> slot
+
+    // Melody matchers (cursor state advanced by the audio thread)
+    MelodyAutomaton melodyAutomaton;
+    MelodyMatcher melodyMatcher;
+
+    // Runtime state, one entry per slot
+    std::vector<juce::uint8> activeFlags;
+    std::vector<int> remainingSamples;     // Minimum on-time left; melody triggers release at zero
+    std::vector<int> missCounts;           // Consecutive checks a note/chord trigger didn't match
+    std::vector<int> activeListPositions;  // Index into activeTriggerSlots, -1 if inactive
+    std::vector<int> activeTriggerSlots;   // Dense list of active slots, reserved to the slot count
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TriggerProgram)
+};
@@ -0,0 +1,142 @@
+#include "DiagnosticsPanel.h"
+#include "../AudioProcessor.h"
+#include "../Utils/RealtimeAllocationGuard.h"
+
+DiagnosticsPanel::DiagnosticsPanel(AudioProcessor* processor, juce::AudioDeviceManager* deviceManager)
+    : audioProcessor(processor), deviceManager(deviceManager)
+{
+    setupUI();
+    startTimerHz(4);
+}
+
+DiagnosticsPanel::~DiagnosticsPanel()
+{
+    stopTimer();
+}
+
+void DiagnosticsPanel::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colour(0xff2d2d2d));
+}
+
+void DiagnosticsPanel::resized()
+{
+    auto bounds = getLocalBounds().reduced(10);
+
+    // Controls
+    auto controlArea = bounds.removeFromTop(40);
+    profileToggle.setBounds(controlArea.removeFromLeft(220).reduced(5));
+    resetButton.setBounds(controlArea.removeFromLeft(120).reduced(5));
+    saveReportButton.setBounds(controlArea.removeFromLeft(120).reduced(5));
+
+    // Counters, then the stage table
+    summaryLabel.setBounds(bounds.removeFromTop(50).reduced(5));
+    statusLabel.setBounds(bounds.removeFromBottom(25).reduced(5, 0));
+    statisticsView.setBounds(bounds.reduced(5));
+}
+
+void DiagnosticsPanel::setupUI()
+{
+    // Setup controls
+    profileToggle.setButtonText("Profile audio callback");
+    profileToggle.setColour(juce::ToggleButton::textColourId, juce::Colours::white);
+    profileToggle.onClick = [this]() {
+        if (audioProcessor)
+            audioProcessor->getProfiler().setEnabled(profileToggle.getToggleState());
+        updateStatistics();
+    };
+    addAndMakeVisible(profileToggle);
+
+    resetButton.setButtonText("Reset");
+    resetButton.onClick = [this]() {
+        if (audioProcessor)
+            audioProcessor->getProfiler().reset();
+        RealtimeAllocationGuard::resetAllocationCount();
+        updateStatistics();
+    };
+    addAndMakeVisible(resetButton);
+
+    saveReportButton.setButtonText("Save Report");
+    saveReportButton.onClick = [this]() { saveReport(); };
+    addAndMakeVisible(saveReportButton);
+
+    // Setup statistics display
+    summaryLabel.setColour(juce::Label::textColourId, juce::Colours::white);
+    summaryLabel.setJustificationType(juce::Justification::topLeft);
+    addAndMakeVisible(summaryLabel);
+
+    statisticsView.setMultiLine(true);
+    statisticsView.setReadOnly(true);
+    statisticsView.setCaretVisible(false);
+    statisticsView.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 14.0f, juce::Font::plain));
+    addAndMakeVisible(statisticsView);
+
+    statusLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
+    addAndMakeVisible(statusLabel);
+
+    updateStatistics();
+}
+
+void DiagnosticsPanel::timerCallback()
+{
+    if (isShowing())
+        updateStatistics();
+}
+
+void DiagnosticsPanel::updateStatistics()
+{
+    if (!audioProcessor)
+        return;
+
+    auto& profiler = audioProcessor->getProfiler();
+    profileToggle.setToggleState(profiler.isEnabled(), juce::dontSendNotification);
+
+    const auto report = profiler.getReport();
+    const auto& total = report.stages[CallbackProfiler::totalIndex];
+
+    juce::String summary;
+    summary << "Callbacks: " << juce::String(report.numCallbacks)
+            << "    Overruns: " << juce::String(report.numOverruns)
+            << "    Late callbacks: " << juce::String(report.numLateCallbacks)
+            << "    " << getDeviceSummary() << "\n"
+            << "Worst callback: " << juce::String(report.toPercentOfPeriod(total.maxUs), 1) << "% of "
+            << juce::String(report.getPeriodUs() / 1000.0, 2) << " ms period";
+
+    if (RealtimeAllocationGuard::isEnabled())
+        summary << "    Audio-thread allocations: " << RealtimeAllocationGuard::getAllocationCount();
+
+    summaryLabel.setText(summary, juce::dontSendNotification);
+    summaryLabel.setColour(juce::Label::textColourId,
+                           report.numOverruns > 0 || report.numLateCallbacks > 0 ? juce::Colours::orange
+                                                                                 : juce::Colours::white);
+
+    statisticsView.setText(profiler.isEnabled() || report.numCallbacks > 0 ? report.toText()
+                                                                           : "Profiling is off. Turn it on to time each stage of the audio callback.",
+                           false);
+}
+
+void DiagnosticsPanel::saveReport()
+{
+    if (!audioProcessor)
+        return;
+
+    auto file = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                    .getChildFile("ToneTrigger")
+                    .getChildFile("Diagnostics")
+                    .getChildFile("callback-profile-" + juce::Time::getCurrentTime().formatted("%Y%m%d-%H%M%S") + ".txt");
+
+    if (audioProcessor->getProfiler().writeReport(file, getDeviceSummary()))
+        statusLabel.setText("Saved " + file.getFullPathName(), juce::dontSendNotification);
+    else
+        statusLabel.setText("Couldn't write " + file.getFullPathName(), juce::dontSendNotification);
+}
+
+juce::String DiagnosticsPanel::getDeviceSummary() const
+{
+    auto* device = deviceManager != nullptr ? deviceManager->getCurrentAudioDevice() : nullptr;
+    if (device == nullptr)
+        return "No audio device";
+
+    const int xruns = device->getXRunCount();
+    return device->getName() + ": " + (xruns >= 0 ? juce::String(xruns) + " device xruns" : juce::String("xruns not reported"));
+}
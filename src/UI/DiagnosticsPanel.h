@@ -0,0 +1,40 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <juce_audio_devices/juce_audio_devices.h>
+
+class AudioProcessor;
+
+// Callback timing from CallbackProfiler: per-stage p50/p99/max against the
+// buffer period, overrun and late-callback counts and the device's own xrun
+// count, refreshed a few times a second while the tab is showing.
+class DiagnosticsPanel : public juce::Component, private juce::Timer
+{
+public:
+    DiagnosticsPanel(AudioProcessor* processor, juce::AudioDeviceManager* deviceManager);
+    ~DiagnosticsPanel() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    AudioProcessor* audioProcessor;
+    juce::AudioDeviceManager* deviceManager;
+
+    // UI Components
+    juce::ToggleButton profileToggle;
+    juce::TextButton resetButton;
+    juce::TextButton saveReportButton;
+    juce::Label summaryLabel;
+    juce::TextEditor statisticsView;
+    juce::Label statusLabel;
+
+    // Methods
+    void setupUI();
+    void timerCallback() override;
+    void updateStatistics();
+    void saveReport();
+    juce::String getDeviceSummary() const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiagnosticsPanel)
+};
@@ -38,6 +38,7 @@ void EffectPanel::resized()
     
     // Right side - effect selection
     auto rightArea = topArea;
+    laneComboBox.setBounds(rightArea.removeFromTop(25).reduced(5));
     effectListComboBox.setBounds(rightArea.removeFromTop(25).reduced(5));
     effectEnabledToggle.setBounds(rightArea.removeFromTop(25).reduced(5));
     
@@ -97,6 +98,13 @@ void EffectPanel::setupUI()
     removeEffectButton.onClick = [this]() { removeSelectedEffect(); };
     addAndMakeVisible(removeEffectButton);
     
+    // Setup lane selection
+    laneComboBox.onChange = [this]() {
+        updateEffectList();
+        updateParameterControls();
+    };
+    addAndMakeVisible(laneComboBox);
+    
     // Setup effect selection
     effectListComboBox.onChange = [this]() { onEffectSelected(); };
     addAndMakeVisible(effectListComboBox);
@@ -108,7 +116,7 @@ void EffectPanel::setupUI()
             int selectedId = effectListComboBox.getSelectedId();
             if (selectedId > 0)
             {
-                audioProcessor->setEffectEnabled(selectedId, effectEnabledToggle.getToggleState());
+                audioProcessor->setEffectEnabled(selectedId, effectEnabledToggle.getToggleState(), getSelectedLane());
             }
         }
     };
@@ -119,7 +127,28 @@ void EffectPanel::setupUI()
     parameterLabel.setColour(juce::Label::textColourId, juce::Colours::white);
     addAndMakeVisible(parameterLabel);
     
+    updateLanes();
+}
+
+void EffectPanel::updateLanes()
+{
+    if (!audioProcessor)
+        return;
+    
+    const int selectedLane = getSelectedLane();
+    
+    laneComboBox.clear(juce::dontSendNotification);
+    for (int lane = 0; lane < audioProcessor->getNumLanes(); ++lane)
+        laneComboBox.addItem(audioProcessor->getLaneName(lane), lane + 1);
+    
+    laneComboBox.setSelectedId(juce::jmin(selectedLane, laneComboBox.getNumItems() - 1) + 1, juce::dontSendNotification);
     updateEffectList();
+    updateParameterControls();
+}
+
+int EffectPanel::getSelectedLane() const
+{
+    return juce::jmax(0, laneComboBox.getSelectedId() - 1);
 }
 
 void EffectPanel::addEffect(int effectType)
@@ -127,7 +156,7 @@ void EffectPanel::addEffect(int effectType)
     if (!audioProcessor)
         return;
     
-    int effectId = audioProcessor->addEffect(effectType);
+    int effectId = audioProcessor->addEffect(effectType, getSelectedLane());
     if (effectId > 0)
     {
         updateEffectList();
@@ -144,7 +173,7 @@ void EffectPanel::removeSelectedEffect()
     int selectedId = effectListComboBox.getSelectedId();
     if (selectedId > 0)
     {
-        audioProcessor->removeEffect(selectedId);
+        audioProcessor->removeEffect(selectedId, getSelectedLane());
         updateEffectList();
         updateParameterControls();
     }
@@ -159,7 +188,7 @@ void EffectPanel::updateEffectList()
     effectListComboBox.clear();
     
     // Get effects from the effect processor
-    auto effectProcessor = audioProcessor->getEffectProcessor();
+    auto effectProcessor = audioProcessor->getEffectProcessor(getSelectedLane());
     if (effectProcessor)
     {
         const auto& effects = effectProcessor->getEffects();
@@ -203,7 +232,7 @@ void EffectPanel::updateParameterControls()
     if (selectedId <= 0)
         return;
     
-    auto effectProcessor = audioProcessor->getEffectProcessor();
+    auto effectProcessor = audioProcessor->getEffectProcessor(getSelectedLane());
     if (!effectProcessor)
         return;
     
@@ -247,7 +276,7 @@ void EffectPanel::onEffectSelected()
     int selectedId = effectListComboBox.getSelectedId();
     if (selectedId > 0)
     {
-        effectEnabledToggle.setToggleState(audioProcessor->isEffectEnabled(selectedId), 
+        effectEnabledToggle.setToggleState(audioProcessor->isEffectEnabled(selectedId, getSelectedLane()), 
                                          juce::dontSendNotification);
         updateParameterControls();
     }
@@ -261,7 +290,7 @@ void EffectPanel::onParameterChanged(int parameterId, float value)
     int selectedId = effectListComboBox.getSelectedId();
     if (selectedId > 0)
     {
-        audioProcessor->setEffectParameter(selectedId, parameterId, value);
+        audioProcessor->setEffectParameter(selectedId, parameterId, value, getSelectedLane());
     }
 }
 
@@ -14,6 +14,8 @@ public:
     void paint(juce::Graphics& g) override;
     void resized() override;
 
+    void updateLanes(); // Call when the processor's channel layout changes
+
 private:
     AudioProcessor* audioProcessor;
 
@@ -24,6 +26,7 @@ private:
     juce::TextButton addChorusButton;
     juce::TextButton removeEffectButton;
     
+    juce::ComboBox laneComboBox;
     juce::ComboBox effectListComboBox;
     juce::ToggleButton effectEnabledToggle;
     
@@ -49,6 +52,7 @@ private:
     void updateParameterControls();
     void onEffectSelected();
     void onParameterChanged(int parameterId, float value);
+    int getSelectedLane() const;
     
     // Helper methods
     juce::String getEffectTypeName(int effectType);
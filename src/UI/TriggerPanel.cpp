@@ -33,6 +33,7 @@ void TriggerPanel::resized()
     
     // Right side - parameter controls
     auto rightArea = topArea;
+    laneComboBox.setBounds(rightArea.removeFromTop(25).reduced(5));
     noteComboBox.setBounds(rightArea.removeFromTop(25).reduced(5));
     effectComboBox.setBounds(rightArea.removeFromTop(25).reduced(5));
     thresholdSlider.setBounds(rightArea.removeFromTop(25).reduced(5));
@@ -61,6 +62,10 @@ void TriggerPanel::setupUI()
     removeTriggerButton.onClick = [this]() { removeSelectedTrigger(); };
     addAndMakeVisible(removeTriggerButton);
     
+    // Setup lane combo box
+    laneComboBox.onChange = [this]() { updateTriggerList(); };
+    addAndMakeVisible(laneComboBox);
+    
     // Setup note combo box
     noteComboBox.addItem("C", 60);
     noteComboBox.addItem("C#", 61);
@@ -99,6 +104,28 @@ void TriggerPanel::setupUI()
     
     triggerListBox.setModel(this);
     addAndMakeVisible(triggerListBox);
+    
+    updateLanes();
+}
+
+void TriggerPanel::updateLanes()
+{
+    if (!audioProcessor)
+        return;
+    
+    const int selectedLane = getSelectedLane();
+    
+    laneComboBox.clear(juce::dontSendNotification);
+    for (int lane = 0; lane < audioProcessor->getNumLanes(); ++lane)
+        laneComboBox.addItem(audioProcessor->getLaneName(lane), lane + 1);
+    
+    laneComboBox.setSelectedId(juce::jmin(selectedLane, laneComboBox.getNumItems() - 1) + 1, juce::dontSendNotification);
+    updateTriggerList();
+}
+
+int TriggerPanel::getSelectedLane() const
+{
+    return juce::jmax(0, laneComboBox.getSelectedId() - 1);
 }
 
 void TriggerPanel::addNoteTrigger()
@@ -110,7 +137,7 @@ void TriggerPanel::addNoteTrigger()
     int effectId = effectComboBox.getSelectedId();
     float threshold = static_cast<float>(thresholdSlider.getValue());
     
-    audioProcessor->addNoteTrigger(note, effectId);
+    audioProcessor->addNoteTrigger(note, effectId, getSelectedLane());
     updateTriggerList();
 }
 
@@ -124,7 +151,7 @@ void TriggerPanel::addChordTrigger()
     std::vector<int> chordNotes = {rootNote, rootNote + 4, rootNote + 7}; // Major triad
     int effectId = effectComboBox.getSelectedId();
     
-    audioProcessor->addChordTrigger(chordNotes, effectId);
+    audioProcessor->addChordTrigger(chordNotes, effectId, getSelectedLane());
     updateTriggerList();
 }
 
@@ -138,7 +165,7 @@ void TriggerPanel::addMelodyTrigger()
     std::vector<int> melodyNotes = {rootNote, rootNote + 2, rootNote + 4, rootNote + 7}; // Simple scale
     int effectId = effectComboBox.getSelectedId();
     
-    audioProcessor->addMelodyTrigger(melodyNotes, effectId);
+    audioProcessor->addMelodyTrigger(melodyNotes, effectId, getSelectedLane());
     updateTriggerList();
 }
 
@@ -148,7 +175,7 @@ void TriggerPanel::removeSelectedTrigger()
     if (selectedRow >= 0 && selectedRow < triggerItems.size())
     {
         int triggerId = triggerItems[selectedRow].id;
-        audioProcessor->removeTrigger(triggerId);
+        audioProcessor->removeTrigger(triggerId, getSelectedLane());
         updateTriggerList();
     }
 }
@@ -160,11 +187,9 @@ void TriggerPanel::updateTriggerList()
     
     triggerItems.clear();
     
-    // Get triggers from the trigger manager
-    auto triggerManager = audioProcessor->getTriggerManager();
-    if (triggerManager)
+    // The audio thread owns the trigger manager; read the message thread's copy
     {
-        const auto& triggers = triggerManager->getTriggers();
+        const auto& triggers = audioProcessor->getTriggers(getSelectedLane());
         for (const auto& trigger : triggers)
         {
             TriggerItem item;
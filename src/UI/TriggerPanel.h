@@ -14,6 +14,8 @@ public:
     void paint(juce::Graphics& g) override;
     void resized() override;
 
+    void updateLanes(); // Call when the processor's channel layout changes
+
 private:
     AudioProcessor* audioProcessor;
 
@@ -23,6 +25,7 @@ private:
     juce::TextButton addMelodyTriggerButton;
     juce::TextButton removeTriggerButton;
     
+    juce::ComboBox laneComboBox;
     juce::ComboBox noteComboBox;
     juce::ComboBox effectComboBox;
     juce::Slider thresholdSlider;
@@ -49,6 +52,7 @@ private:
     void addMelodyTrigger();
     void removeSelectedTrigger();
     void updateTriggerList();
+    int getSelectedLane() const;
     
     // Helper methods
     juce::String noteNumberToString(int note);
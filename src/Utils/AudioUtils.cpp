@@ -154,6 +154,18 @@ void applyGain(juce::AudioBuffer<float>& buffer, float gain)
     }
 }
 
+void softClip(float* samples, int numSamples)
+{
+    // Pade approximant of tanh; at the clamp points it has already reached +/-1
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float x = std::min(5.0f, std::max(-5.0f, samples[i]));
+        const float x2 = x * x;
+        samples[i] = x * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2)))
+                   / (135135.0f + x2 * (62370.0f + x2 * (3150.0f + x2 * 28.0f)));
+    }
+}
+
 std::vector<float> createHannWindow(int size)
 {
     std::vector<float> window(size);
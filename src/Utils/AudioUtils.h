@@ -34,6 +34,7 @@ namespace AudioUtils
     void copyBuffer(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& destination);
     void clearBuffer(juce::AudioBuffer<float>& buffer);
     void applyGain(juce::AudioBuffer<float>& buffer, float gain);
+    void softClip(float* samples, int numSamples); // Fast tanh, branch-free so it vectorises
     
     // Window functions
     std::vector<float> createHannWindow(int size);
@@ -0,0 +1,93 @@
+#include "RealtimeAllocationGuard.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace RealtimeAllocationGuard
+{
+
+namespace
+{
+    std::atomic<int> allocationCount { 0 };
+    std::atomic<bool> assertOnAllocation { false };
+
+#if TONETRIGGER_CHECK_AUDIO_ALLOCATIONS
+    thread_local int realtimeDepth = 0;
+#endif
+}
+
+#if TONETRIGGER_CHECK_AUDIO_ALLOCATIONS
+ScopedRealtimeSection::ScopedRealtimeSection()
+{
+    ++realtimeDepth;
+}
+
+ScopedRealtimeSection::~ScopedRealtimeSection()
+{
+    --realtimeDepth;
+}
+
+static void noteAllocation()
+{
+    if (realtimeDepth == 0)
+        return;
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (assertOnAllocation.load(std::memory_order_relaxed))
+    {
+        // Leave the section while asserting, the assertion logger allocates too
+        const int depth = realtimeDepth;
+        realtimeDepth = 0;
+        jassertfalse;
+        realtimeDepth = depth;
+    }
+}
+#endif
+
+int getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+void resetAllocationCount()
+{
+    allocationCount.store(0, std::memory_order_relaxed);
+}
+
+void setAssertOnAllocation(bool shouldAssert)
+{
+    assertOnAllocation.store(shouldAssert, std::memory_order_relaxed);
+}
+
+} // namespace RealtimeAllocationGuard
+
+#if TONETRIGGER_CHECK_AUDIO_ALLOCATIONS
+// Replacement global allocation functions; the nothrow and sized variants
+// provided by the standard library forward to these
+void* operator new(std::size_t size)
+{
+    RealtimeAllocationGuard::noteAllocation();
+
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+// Debug aid for keeping the audio callback allocation-free.
+//
+// When TONETRIGGER_CHECK_AUDIO_ALLOCATIONS is defined the global operator new is
+// replaced so that every heap allocation made while a ScopedRealtimeSection is
+// alive on the calling thread is counted (and optionally asserted). Without the
+// define the section is an empty object and costs nothing.
+namespace RealtimeAllocationGuard
+{
+#if TONETRIGGER_CHECK_AUDIO_ALLOCATIONS
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection();
+        ~ScopedRealtimeSection();
+
+        ScopedRealtimeSection(const ScopedRealtimeSection&) = delete;
+        ScopedRealtimeSection& operator=(const ScopedRealtimeSection&) = delete;
+    };
+
+    constexpr bool isEnabled() { return true; }
+#else
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection() {}
+    };
+
+    constexpr bool isEnabled() { return false; }
+#endif
+
+    // Number of allocations made inside a real-time section since the last reset
+    int getAllocationCount();
+    void resetAllocationCount();
+
+    // Break into the debugger on the first offending allocation
+    void setAssertOnAllocation(bool shouldAssert);
+}
@@ -0,0 +1,263 @@
+#include "RealtimeWorkerPool.h"
+#include "RealtimeAllocationGuard.h"
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <cerrno>
+ #include <semaphore.h>
+#endif
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+    // Busy-wait hint, so a hyperthread sibling gets the core while we spin
+    inline void pause() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_GCC || JUCE_CLANG)
+        __asm__ __volatile__("yield");
+       #endif
+    }
+
+    constexpr juce::uint64 packState(juce::uint32 generation, int numJobs, int nextIndex)
+    {
+        return (static_cast<juce::uint64>(generation) << 32)
+             | (static_cast<juce::uint64>(numJobs) << 16)
+             | static_cast<juce::uint64>(nextIndex);
+    }
+
+    constexpr juce::uint32 generationOf(juce::uint64 state) { return static_cast<juce::uint32>(state >> 32); }
+    constexpr int numJobsOf(juce::uint64 state) { return static_cast<int>((state >> 16) & 0xffff); }
+    constexpr int nextIndexOf(juce::uint64 state) { return static_cast<int>(state & 0xffff); }
+}
+
+// Posting never takes a user-space lock: a dispatch semaphore on Apple
+// platforms, a kernel semaphore on Windows and a POSIX one elsewhere
+class RealtimeWorkerPool::Semaphore
+{
+public:
+    Semaphore()
+    {
+       #if JUCE_MAC || JUCE_IOS
+        semaphore = dispatch_semaphore_create(0);
+       #elif JUCE_WINDOWS
+        semaphore = CreateSemaphoreW(nullptr, 0, LONG_MAX, nullptr);
+       #else
+        sem_init(&semaphore, 0, 0);
+       #endif
+    }
+
+    ~Semaphore()
+    {
+       #if JUCE_MAC || JUCE_IOS
+        dispatch_release(semaphore);
+       #elif JUCE_WINDOWS
+        CloseHandle(semaphore);
+       #else
+        sem_destroy(&semaphore);
+       #endif
+    }
+
+    void post() noexcept
+    {
+       #if JUCE_MAC || JUCE_IOS
+        dispatch_semaphore_signal(semaphore);
+       #elif JUCE_WINDOWS
+        ReleaseSemaphore(semaphore, 1, nullptr);
+       #else
+        sem_post(&semaphore);
+       #endif
+    }
+
+    void wait() noexcept
+    {
+       #if JUCE_MAC || JUCE_IOS
+        dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+       #elif JUCE_WINDOWS
+        WaitForSingleObject(semaphore, INFINITE);
+       #else
+        while (sem_wait(&semaphore) != 0 && errno == EINTR) {}
+       #endif
+    }
+
+private:
+   #if JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_t semaphore;
+   #elif JUCE_WINDOWS
+    HANDLE semaphore;
+   #else
+    sem_t semaphore;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE(Semaphore)
+};
+
+class RealtimeWorkerPool::Worker : public juce::Thread
+{
+public:
+    Worker(RealtimeWorkerPool& owner, int core)
+        : juce::Thread("ToneTrigger Worker"), pool(owner), coreIndex(core)
+    {
+    }
+
+    void run() override
+    {
+        if (coreIndex >= 0 && coreIndex < 32)
+            juce::Thread::setCurrentThreadAffinityMask(1u << coreIndex);
+
+        pool.workerLoop(*this);
+    }
+
+private:
+    RealtimeWorkerPool& pool;
+    int coreIndex; // -1 leaves it to the scheduler
+};
+
+RealtimeWorkerPool::RealtimeWorkerPool()
+{
+    wakeSemaphore = std::make_unique<Semaphore>();
+}
+
+RealtimeWorkerPool::~RealtimeWorkerPool()
+{
+    release();
+}
+
+void RealtimeWorkerPool::prepare(int numWorkers, int samplesPerBlockExpected, double sampleRate, int spinMicroseconds)
+{
+    release();
+
+    spinTicks = juce::Time::secondsToHighResolutionTicks(spinMicroseconds * 1.0e-6);
+    numCompleted.store(0);
+    numParked.store(0);
+
+    // Keep off the first core, where the system tends to put its own work
+    const int numCores = juce::SystemStats::getNumCpus();
+    const auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(samplesPerBlockExpected, sampleRate);
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>(*this, numCores > 1 ? 1 + i % (numCores - 1) : -1));
+
+        // A worker an ordinary thread could preempt would leave the audio
+        // thread spinning on its job, so it's real-time workers or none
+        if (!workers.back()->startRealtimeThread(options))
+        {
+            release();
+            return;
+        }
+    }
+}
+
+void RealtimeWorkerPool::release()
+{
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+
+    // Parked workers only notice once they're woken
+    for (size_t i = 0; i < workers.size(); ++i)
+        wakeSemaphore->post();
+
+    for (auto& worker : workers)
+        worker->stopThread(1000);
+
+    workers.clear();
+}
+
+void RealtimeWorkerPool::run(int numJobs, JobFunction job, void* context) noexcept
+{
+    if (numJobs <= 0)
+        return;
+
+    if (workers.empty() || numJobs == 1 || numJobs > maxJobs || batchInFlight.exchange(true, std::memory_order_acquire))
+    {
+        runInline(numJobs, job, context);
+        return;
+    }
+
+    // Nobody can be running a job from the last batch, so its fields are free
+    currentJob = job;
+    currentContext = context;
+    numCompleted.store(0, std::memory_order_relaxed);
+
+    const juce::uint32 generation = generationOf(state.load(std::memory_order_relaxed)) + 1;
+    state.store(packState(generation, numJobs, 0), std::memory_order_seq_cst);
+
+    // Wake parked workers, as many as there are jobs besides the one we'll take
+    const int numToWake = juce::jmin(numParked.load(std::memory_order_seq_cst), numJobs - 1);
+    for (int i = 0; i < numToWake; ++i)
+        wakeSemaphore->post();
+
+    claimJobs(generation);
+
+    // Whatever's left was started by a worker already, and workers run at
+    // real-time priority, so nothing ordinary can hold this wait up
+    while (numCompleted.load(std::memory_order_acquire) < numJobs)
+        pause();
+
+    batchInFlight.store(false, std::memory_order_release);
+}
+
+void RealtimeWorkerPool::runInline(int numJobs, JobFunction job, void* context) noexcept
+{
+    for (int index = 0; index < numJobs; ++index)
+        job(context, index);
+}
+
+void RealtimeWorkerPool::claimJobs(juce::uint32 generation) noexcept
+{
+    auto current = state.load(std::memory_order_acquire);
+
+    while (generationOf(current) == generation && nextIndexOf(current) < numJobsOf(current))
+    {
+        if (!state.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            continue;
+
+        // The batch can't finish before this job does, so its fields stay put
+        currentJob(currentContext, nextIndexOf(current));
+        numCompleted.fetch_add(1, std::memory_order_release);
+        current = state.load(std::memory_order_acquire);
+    }
+}
+
+void RealtimeWorkerPool::workerLoop(Worker& worker)
+{
+    juce::uint32 seenGeneration = generationOf(state.load(std::memory_order_acquire));
+
+    while (!worker.threadShouldExit())
+    {
+        // Spin for a little while in case another batch follows straight away
+        const auto spinStart = juce::Time::getHighResolutionTicks();
+        juce::uint32 generation = generationOf(state.load(std::memory_order_acquire));
+
+        while (generation == seenGeneration && juce::Time::getHighResolutionTicks() - spinStart < spinTicks)
+        {
+            pause();
+            generation = generationOf(state.load(std::memory_order_acquire));
+        }
+
+        if (generation == seenGeneration)
+        {
+            // Say we're parking before the last look, so a batch published in
+            // between either shows up here or sees us and posts
+            numParked.fetch_add(1, std::memory_order_seq_cst);
+            if (generationOf(state.load(std::memory_order_seq_cst)) == seenGeneration)
+                wakeSemaphore->wait();
+            numParked.fetch_sub(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        seenGeneration = generation;
+
+        // Jobs are audio-thread work, wherever they run
+        RealtimeAllocationGuard::ScopedRealtimeSection realtimeSection;
+        claimJobs(generation);
+    }
+}
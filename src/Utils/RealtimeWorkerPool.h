@@ -0,0 +1,73 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Spreads independent jobs from the audio callback across a few real-time
+// worker threads, so work that would otherwise queue up on one core finishes
+// inside the same deadline.
+//
+// The calling thread always takes jobs too, and only ever waits for jobs a
+// worker has already started: a worker that's slow to wake just leaves its
+// share to the caller. Dispatching is a handful of atomics. Workers spin for a
+// short while after each batch so back-to-back batches find them awake, then
+// park on a semaphore, which the caller posts without taking a lock.
+class RealtimeWorkerPool
+{
+public:
+    RealtimeWorkerPool();
+    ~RealtimeWorkerPool();
+
+    // Setup (audio stopped). The audio thread waits on jobs a worker has
+    // claimed, so workers are real-time threads scheduled for the device's
+    // block like the audio thread itself, each pinned to a core of its own
+    // where the platform allows it. If the platform refuses real-time threads
+    // (no permission on Linux, say) the pool starts none, and with no workers
+    // every batch runs inline.
+    void prepare(int numWorkers, int samplesPerBlockExpected, double sampleRate,
+                 int spinMicroseconds = defaultSpinMicroseconds);
+    void release();
+    int getNumWorkers() const { return static_cast<int>(workers.size()); }
+
+    // Audio thread. Calls function(index) once for each index in [0, numJobs)
+    // and returns when they've all finished. Runs them inline, in order, when
+    // there's nothing to spread them over or a batch is already in flight (a
+    // job that dispatches again, say).
+    template <typename Function>
+    void parallelFor(int numJobs, Function& function) noexcept
+    {
+        run(numJobs, [](void* context, int index) { (*static_cast<Function*>(context))(index); }, &function);
+    }
+
+    using JobFunction = void (*)(void* context, int index);
+    void run(int numJobs, JobFunction job, void* context) noexcept;
+
+    static constexpr int defaultSpinMicroseconds = 50;
+    static constexpr int maxJobs = 0xffff;
+
+private:
+    class Worker;
+    class Semaphore;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<Semaphore> wakeSemaphore;
+    juce::int64 spinTicks = 0;
+
+    // The current batch. state packs the batch's generation (high 32 bits),
+    // its job count (16 bits) and the next unclaimed index (16 bits), so a
+    // claim can't land on a batch other than the one it read.
+    std::atomic<juce::uint64> state { 0 };
+    std::atomic<int> numCompleted { 0 };
+    std::atomic<int> numParked { 0 };
+    std::atomic<bool> batchInFlight { false };
+    JobFunction currentJob = nullptr;
+    void* currentContext = nullptr;
+
+    void runInline(int numJobs, JobFunction job, void* context) noexcept;
+    void claimJobs(juce::uint32 generation) noexcept; // Runs jobs from the batch until none are left
+    void workerLoop(Worker& worker);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RealtimeWorkerPool)
+};